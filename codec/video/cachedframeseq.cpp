@@ -0,0 +1,127 @@
+#include "cachedframeseq.hpp"
+#include "frameutil.hpp"
+
+#include <utility>
+
+namespace mlib::codec::video
+{
+
+//
+// tellFrame re-decode points
+//
+
+Tellseeker::Tellseeker(IVideoDecodec &source, size_t keyinterval)
+    : Source(&source), Keyinterval(keyinterval ? keyinterval : 1)
+{
+}
+
+void Tellseeker::mark(size_t idx)
+{
+    if(idx % Keyinterval == 0 && idx / Keyinterval == Keys.size())
+        Keys.push_back(Source->tellFrame());
+}
+
+size_t Tellseeker::keyframe(size_t idx) const
+{
+    return idx / Keyinterval * Keyinterval;
+}
+
+void Tellseeker::seek(size_t key)
+{
+    Source->seekFrame(*Keys[key / Keyinterval]);
+}
+
+//
+// frame sequence
+//
+
+Cachedframeseq::Cachedframeseq(IVideoDecodec &source, size_t budget, size_t keyinterval)
+    : Source(&source), Owned(std::make_unique<Tellseeker>(source, keyinterval)), Seeker(Owned.get()), Buffers(4), Budget(budget),
+    Next(0), Bytes(0), Hits(0), Misses(0)
+{
+}
+
+Cachedframeseq::Cachedframeseq(IVideoDecodec &source, IFrameseeker &seeker, size_t budget)
+    : Source(&source), Seeker(&seeker), Buffers(4), Budget(budget),
+    Next(0), Bytes(0), Hits(0), Misses(0)
+{
+}
+
+void Cachedframeseq::load()
+{
+    for(size_t i = Frames.size();; ++i)
+    {
+        Seeker->mark(i);
+
+        Videoframe f;
+        if(!Source->fetchFrame(f))
+            break;
+
+        Frames.emplace_back();
+        Frames.back().Use = Recent.end();
+        store(i, f);
+        Next = i + 1;
+    }
+}
+
+Videoframe Cachedframeseq::operator[](size_t idx)
+{
+    auto &fr = Frames[idx];
+    if(fr.Use != Recent.end())
+    {
+        ++Hits;
+        Recent.splice(Recent.begin(), Recent, fr.Use);
+        return fr.Info;
+    }
+
+    ++Misses;
+    decode(idx);
+    return Frames[idx].Info;
+}
+
+void Cachedframeseq::decode(size_t idx)
+{
+    //continue without seeking if the source is between the key frame and the frame
+    size_t key = Seeker->keyframe(idx);
+    if(Next < key || Next > idx)
+    {
+        Seeker->seek(key);
+        Next = key;
+    }
+
+    for(; Next <= idx; ++Next)
+    {
+        Videoframe f;
+        if(!Source->fetchFrame(f))
+            throw GenericCodecError<StreamUnexpectedEnd>("cachedframeseq", "frame " + std::to_string(Next));
+
+        if(Frames[Next].Use == Recent.end())
+            store(Next, f);
+    }
+}
+
+void Cachedframeseq::store(size_t idx, const Videoframe &f)
+{
+    auto &fr = Frames[idx];
+    fr.Bytes = frameBytes(f.Format, f.Width, f.Height);
+    evict(fr.Bytes);
+
+    fr.Info = f.Owner ? f : copyFrame(f, Buffers);
+    Recent.push_front(idx);
+    fr.Use = Recent.begin();
+    Bytes += fr.Bytes;
+}
+
+void Cachedframeseq::evict(size_t bytes)
+{
+    while(!Recent.empty() && Bytes + bytes > Budget)
+    {
+        auto &fr = Frames[Recent.back()];
+        fr.Info.Owner.reset();
+        fr.Use = Recent.end();
+        Bytes -= fr.Bytes;
+        Recent.pop_back();
+    }
+}
+
+}
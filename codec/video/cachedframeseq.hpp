@@ -0,0 +1,115 @@
+#pragma once
+
+#include <vector>
+#include <list>
+#include <memory>
+
+#include "codec.hpp"
+#include "framepool.hpp"
+
+namespace mlib::codec::video
+{
+
+//
+// re-decode points
+//
+// Positions the source of a Cachedframeseq to decode evicted frames again.
+// - mark is called while loading, before the source decodes frame idx.
+// - keyframe returns the frame at or before idx that decoding can restart at.
+// - seek positions the source so that its next frame is a frame returned by keyframe.
+//
+
+class IFrameseeker
+{
+public:
+    virtual ~IFrameseeker() = default;
+
+    virtual void mark(size_t idx) = 0;
+    virtual size_t keyframe(size_t idx) const = 0;
+    virtual void seek(size_t key) = 0;
+};
+
+//
+// tellFrame re-decode points
+//
+// Keeps a position of the source every keyinterval frames and restarts at the nearest preceding one.
+// Only valid for sources that continue correctly from any position returned by tellFrame, such as
+// GopDecoder, PIQ or frame sequences. Positions of an h264::Decoder taken within a GOP are not valid
+// re-decode points, since the reference frames are lost; use h264::Indexseeker for it.
+//
+
+class Tellseeker : public IFrameseeker
+{
+public:
+    Tellseeker(IVideoDecodec &source, size_t keyinterval = 30);
+
+    void mark(size_t idx) override;
+    size_t keyframe(size_t idx) const override;
+    void seek(size_t key) override;
+
+private:
+    IVideoDecodec *Source;
+    size_t Keyinterval;
+    std::vector<std::unique_ptr<ISourceSeek>> Keys;
+};
+
+//
+// memory-budgeted frame sequence
+//
+// Holds the frames of a source decoder within a budget of bytes. When the budget is exceeded,
+// the least recently used frames are evicted and decoded again when accessed, starting at the
+// preceding re-decode point of a seeker for the same source, keeping the frames decoded on the way.
+// Without a seeker, a Tellseeker with the given keyinterval is used, see its restrictions.
+// The seeker must stay valid.
+// - load decodes the whole source once and marks re-decode points, keeping what fits the budget.
+// - operator[] returns a frame, which stays valid after eviction by its Owner.
+// - hits and misses count accesses to held and evicted frames.
+//
+
+class Cachedframeseq
+{
+public:
+    Cachedframeseq(IVideoDecodec &source, size_t budget, size_t keyinterval = 30);
+    Cachedframeseq(IVideoDecodec &source, IFrameseeker &seeker, size_t budget);
+
+    void load();
+
+    size_t length() const { return Frames.size(); }
+    Videoframe operator[](size_t idx);
+
+    size_t budget() const { return Budget; }
+    size_t bytes() const { return Bytes; }
+    size_t hits() const { return Hits; }
+    size_t misses() const { return Misses; }
+
+    Cachedframeseq(Cachedframeseq&&) = delete;
+    Cachedframeseq(const Cachedframeseq&) = delete;
+    Cachedframeseq &operator=(Cachedframeseq&&) = delete;
+    Cachedframeseq &operator=(const Cachedframeseq&) = delete;
+
+private:
+    struct Frame
+    {
+        Videoframe Info;
+        size_t Bytes = 0;
+        std::list<size_t>::iterator Use;
+    };
+
+    void store(size_t idx, const Videoframe &f);
+    void evict(size_t bytes);
+    void decode(size_t idx);
+
+    IVideoDecodec *Source;
+    std::unique_ptr<IFrameseeker> Owned;
+    IFrameseeker *Seeker;
+    Framepool Buffers;
+    size_t Budget;
+
+    std::vector<Frame> Frames;
+    std::list<size_t> Recent; //held frames, most recently used first
+    size_t Next; //frame the source continues with
+
+    size_t Bytes, Hits, Misses;
+};
+
+}
@@ -0,0 +1,36 @@
+#include "codec.hpp"
+#include "framepool.hpp"
+
+namespace mlib::codec::video
+{
+
+//
+// default batch fetching
+//
+// Frames without Owner are copied to a pool shared by all decoders using the default. It lives from
+// the first batch until program exit, copies outlive it by their Owner. Few buffers are kept idle,
+// so that batches of large frames do not stay allocated once the caller has released them.
+//
+
+static Framepool &batchPool()
+{
+    static Framepool pool(4);
+    return pool;
+}
+
+size_t IVideoDecodec::fetchFrames(Videoframe *frames, size_t count)
+{
+    size_t n = 0;
+    for(; n < count; ++n)
+    {
+        if(n > 0 && !frames[n - 1].Owner) //the next fetchFrame may reuse its buffer
+            frames[n - 1] = copyFrame(frames[n - 1], batchPool());
+
+        if(!fetchFrame(frames[n]))
+            break;
+    }
+
+    return n;
+}
+
+}
@@ -3,6 +3,7 @@
 #include <string>
 #include <stdexcept>
 #include <cstddef>
+#include <cstdint>
 #include <memory>
 #include <functional>
 
@@ -47,6 +48,11 @@ struct StreamUnexpectedEnd : public StreamMalformed
     StreamUnexpectedEnd(const std::string &e) : StreamMalformed(".end" + e) {}
 };
 
+struct SeekUnsupported : public CodecError
+{
+    SeekUnsupported(const std::string &e) : CodecError(".seekunsupported" + e) {}
+};
+
 template<class ErrorClass>
 struct GenericCodecError : public ErrorClass
 {
@@ -80,6 +86,10 @@ struct ISourceSeek
 // - sourceTell returns an object holding the current offset of the mapped buffer
 //   into the stream which can be passed to sourceSeek later.
 // - minimalBuffer calls extendBuffer if the buffer is not large enough.
+// - sourceOffset returns the offset of the buffer's begin into the stream.
+// - sourceSeekOffset moves the buffer's begin to an offset into the stream.
+//   The buffer's size is unspecified afterwards, so it has to be extended as needed.
+//   Sources which cannot seek by offset throw SeekUnsupported.
 //
 
 struct ICodecSourcebuffer
@@ -97,16 +107,29 @@ struct ICodecSourcebuffer
     {
         auto[ptr, len] = bufferProperties();
         if(len < minimumlength)
-            std::tie(ptr, len) = extendBuffer(minimumlength - len);
+        {
+            extendBuffer(minimumlength - len);
+            std::tie(ptr, len) = bufferProperties();
+        }
 
         return { ptr, len };
     }
+
+    virtual uint64_t sourceOffset() const
+    {
+        throw SeekUnsupported(" (offset)");
+    }
+    virtual void sourceSeekOffset(uint64_t)
+    {
+        throw SeekUnsupported(" (offset)");
+    }
 };
 
 //
 // video frame
 //
 // Holds pointers to up to four planes, their number of bytes and their line strides.
+// Owner, if set, keeps the pixels alive, so the frame stays valid beyond further calls to the codec.
 //
 
 struct Videoframe
@@ -115,8 +138,14 @@ struct Videoframe
     unsigned int Width, Height;
     const void *Planes[4];
     size_t Linestrides[4];
+    std::shared_ptr<const void> Owner;
 };
 
+class Framepool;
+struct Codecstats;
+
+enum class Frameskip { None, Nonreference, Keyframe };
+
 //
 // log callback
 //
@@ -133,6 +162,19 @@ enum class CodecLoglevel { None, Info, Debug };
 // - fetchFrame returns a Videoframe. The codec itself manages the buffer of pixels, so
 //   the user can only rely on the pointers to be valid until another call to the codec's methods.
 //   Returns false in case of end of stream.
+// - fetchFrames fetches up to count frames into frames and returns how many, fewer only at the
+//   end of stream. All of them stay valid until another call to the codec's methods.
+//   The default implementation calls fetchFrame, copying frames without Owner except the last
+//   to a Framepool shared by all codecs, which lives until program exit and keeps few buffers idle.
+//   Codecs override it to save the copies or to decode frames together.
+// - codecFramepool makes the codec hand out frames with buffers taken from a pool, see Videoframe::Owner.
+//   Codecs without support ignore it. nullptr disables pooling.
+// - codecStats returns the codec's statistics, which stay valid as long as the codec, or nullptr
+//   if it keeps none. See Codecstats.
+// - codecSkip makes the codec skip frames without decoding them while the mode is not None,
+//   counting them as skipped (see Codecstats). Nonreference skips frames no other frame refers to,
+//   Keyframe skips frames up to the next keyframe and then returns to None.
+//   Returns false if the codec does not support the mode.
 //
 
 struct IVideoDecodec
@@ -143,9 +185,35 @@ struct IVideoDecodec
     virtual void codecParameter(const std::string &parameter, const std::string &value) = 0;
 
     virtual bool fetchFrame(Videoframe&) = 0;
+    virtual size_t fetchFrames(Videoframe *frames, size_t count);
 
     virtual std::unique_ptr<ISourceSeek> tellFrame() const = 0;
     virtual void seekFrame(const ISourceSeek&) = 0;
+
+    virtual void codecFramepool(std::shared_ptr<Framepool>) {}
+    virtual const Codecstats *codecStats() const { return nullptr; }
+    virtual bool codecSkip(Frameskip mode) { return mode == Frameskip::None; }
+};
+
+//
+// video encoder
+//
+// - codecParameter sets codec-specific options.
+// - encodeFrame encodes a frame and writes the encoded data to the codec's output.
+//   The frame's pixels are only read during the call.
+// - codecStats returns the codec's statistics or nullptr, see IVideoDecodec.
+//
+
+struct IVideoEncodec
+{
+    virtual ~IVideoEncodec() = default;
+
+    virtual void codecLogging(CodecLoglevel, CodecLogger) = 0;
+    virtual void codecParameter(const std::string &parameter, const std::string &value) = 0;
+
+    virtual void encodeFrame(const Videoframe&) = 0;
+
+    virtual const Codecstats *codecStats() const { return nullptr; }
 };
 
 }
\ No newline at end of file
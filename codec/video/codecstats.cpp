@@ -0,0 +1,52 @@
+#include "codecstats.hpp"
+
+namespace mlib::codec::video
+{
+
+using Clock = std::chrono::steady_clock;
+
+void Codecstats::addDecodetime(Clock::duration d)
+{
+    auto us = std::chrono::duration_cast<std::chrono::microseconds>(d).count();
+
+    size_t bucket = 0;
+    while(us > 0 && bucket + 1 < Timebuckets)
+    {
+        us >>= 1;
+        ++bucket;
+    }
+
+    add(Decodetime[bucket]);
+}
+
+void Codecstats::reset()
+{
+    for(auto *c : { &Frames, &Dropped, &Skipped, &Units, &BytesConsumed, &ExtendCalls, &ExtendBytes, &AdvanceCalls, &AdvanceBytes, &SourceNanoseconds, &BytesProduced })
+        c->store(0, std::memory_order_relaxed);
+    for(auto &b : Decodetime)
+        b.store(0, std::memory_order_relaxed);
+}
+
+std::pair<const void*, size_t> Statsource::extendBuffer(size_t length)
+{
+    auto begin = Clock::now();
+    auto r = Source->extendBuffer(length);
+
+    Codecstats::add(Stats->SourceNanoseconds, std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - begin).count());
+    Codecstats::add(Stats->ExtendCalls);
+    Codecstats::add(Stats->ExtendBytes, r.second);
+    return r;
+}
+
+std::pair<const void*, size_t> Statsource::advanceBuffer(size_t amount)
+{
+    auto begin = Clock::now();
+    auto r = Source->advanceBuffer(amount);
+
+    Codecstats::add(Stats->SourceNanoseconds, std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - begin).count());
+    Codecstats::add(Stats->AdvanceCalls);
+    Codecstats::add(Stats->AdvanceBytes, r.second);
+    return r;
+}
+
+}
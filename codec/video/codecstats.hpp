@@ -0,0 +1,76 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+#include "codec.hpp"
+
+namespace mlib::codec::video
+{
+
+//
+// codec statistics
+//
+// Counters a codec updates while decoding, see IVideoDecodec::codecStats. They are relaxed atomics,
+// so any thread may read them without locking, though not as a consistent snapshot.
+// - Frames: frames returned by fetchFrame
+// - Dropped: frames which failed to decode, for H264 pictures with a slice openh264 failed to decode
+// - Skipped: frames skipped without decoding them, see IVideoDecodec::codecSkip, or by an encoder's rate control
+// - Units: units parsed, NAL units for H264 and frame payloads for PIQ
+// - BytesConsumed: bytes of the units passed to decoding, or of the source frames' pixels for conversions
+// - ExtendCalls, ExtendBytes, AdvanceCalls, AdvanceBytes: calls to the source's extendBuffer and
+//   advanceBuffer and the number of bytes they read
+// - SourceNanoseconds: time spent in these calls
+// - Decodetime: histogram of the time a fetchFrame took, without fetching the source frame for conversions.
+//   Bucket 0 counts durations below 1 microsecond, bucket n those below 2^n microseconds,
+//   the last bucket all longer ones.
+// - BytesProduced: bytes written by encoders
+//
+// reset sets all counters to 0, for codecs starting over with another stream.
+//
+// Encoders count encoded frames, frames skipped by rate control as skipped, NAL units written,
+// the input frames' pixel bytes as consumed and the time an encodeFrame took as decode time.
+//
+
+struct Codecstats
+{
+    static constexpr size_t Timebuckets = 24;
+
+    std::atomic<uint64_t> Frames{ 0 }, Dropped{ 0 }, Skipped{ 0 }, Units{ 0 }, BytesConsumed{ 0 };
+    std::atomic<uint64_t> ExtendCalls{ 0 }, ExtendBytes{ 0 }, AdvanceCalls{ 0 }, AdvanceBytes{ 0 };
+    std::atomic<uint64_t> SourceNanoseconds{ 0 }, BytesProduced{ 0 };
+    std::atomic<uint64_t> Decodetime[Timebuckets] = {};
+
+    static void add(std::atomic<uint64_t> &counter, uint64_t n = 1) { counter.fetch_add(n, std::memory_order_relaxed); }
+    void addDecodetime(std::chrono::steady_clock::duration d);
+    void reset();
+};
+
+//
+// counting sourcebuffer
+//
+// Forwards to another source, counting calls to extendBuffer and advanceBuffer into statistics.
+//
+
+class Statsource : public ICodecSourcebuffer
+{
+public:
+    Statsource(ICodecSourcebuffer &source, Codecstats &stats) : Source(&source), Stats(&stats) {}
+
+    std::pair<const void*, size_t> extendBuffer(size_t length) override;
+    std::pair<const void*, size_t> advanceBuffer(size_t amount) override;
+    std::pair<const void*, size_t> bufferProperties() const override { return Source->bufferProperties(); }
+
+    std::unique_ptr<ISourceSeek> sourceTell() const override { return Source->sourceTell(); }
+    void sourceSeek(const ISourceSeek &s) override { Source->sourceSeek(s); }
+
+    uint64_t sourceOffset() const override { return Source->sourceOffset(); }
+    void sourceSeekOffset(uint64_t offset) override { Source->sourceSeekOffset(offset); }
+
+private:
+    ICodecSourcebuffer *Source;
+    Codecstats *Stats;
+};
+
+}
@@ -0,0 +1,246 @@
+#include "decodeahead.hpp"
+#include "frameutil.hpp"
+#include "framepool.hpp"
+
+#include <utility>
+#include <cassert>
+#include <cstdio>
+
+namespace mlib::codec::video
+{
+
+struct AheadSeek : public ISourceSeek
+{
+    std::shared_ptr<const ISourceSeek> Position;
+};
+
+Decodeahead::Decodeahead(IVideoDecodec &source, size_t depth) : Source(&source)
+{
+    if(depth == 0)
+        throw GenericCodecError<WrongParameter>("decodeahead", "prefetch");
+
+    Ring.resize(depth + 1); //one additional slot is held by the consumer
+    Head = Count = 0;
+    Holding = Ended = Stopping = false;
+    Pending = Source->tellFrame();
+
+    start();
+}
+
+Decodeahead::~Decodeahead()
+{
+    stop();
+}
+
+void Decodeahead::start()
+{
+    Stopping = false;
+    if(!Ended && !Error)
+        Worker = std::thread(&Decodeahead::work, this);
+}
+
+void Decodeahead::stop()
+{
+    {
+        std::lock_guard<std::mutex> l(Lock);
+        Stopping = true;
+    }
+    Consumed.notify_all();
+
+    if(Worker.joinable())
+        Worker.join();
+}
+
+void Decodeahead::paused(const std::function<void()> &f)
+{
+    stop();
+
+    try
+    {
+        f();
+    }
+    catch(...)
+    {
+        start(); //the worker continues where it stopped
+        throw;
+    }
+
+    start();
+}
+
+void Decodeahead::restart(std::shared_ptr<const ISourceSeek> position, size_t depth)
+{
+    paused([&]()
+    {
+        Source->seekFrame(*position);
+
+        Ring.clear();
+        Ring.resize(depth + 1);
+        Head = Count = 0;
+        Holding = Ended = false;
+        Error = nullptr;
+        Pending = std::move(position);
+    });
+}
+
+void Decodeahead::work()
+{
+    try
+    {
+        for(;;)
+        {
+            size_t slotidx;
+            bool setskip;
+            Frameskip skip;
+            {
+                std::unique_lock<std::mutex> l(Lock);
+                Consumed.wait(l, [&]() { return Stopping || Count < Ring.size(); });
+                if(Stopping)
+                    return;
+
+                slotidx = (Head + Count) % Ring.size(); //slot is not visible to the consumer until Count is increased
+                setskip = Skippending;
+                skip = Skip;
+                Skippending = false;
+            }
+
+            if(setskip && !Source->codecSkip(skip))
+            {
+                std::lock_guard<std::mutex> l(Lock);
+                Unsupported[static_cast<size_t>(skip)] = true;
+            }
+
+            Videoframe fr;
+            bool success = Source->fetchFrame(fr);
+            std::shared_ptr<const ISourceSeek> next = Source->tellFrame();
+
+            auto &slot = Ring[slotidx];
+            if(success && fr.Owner)
+                slot.Frame = fr;
+            else if(success && Buffers)
+                slot.Frame = copyFrame(fr, *Buffers);
+            else if(success)
+            {
+                slot.Pixels.resize(frameBytes(fr.Format, fr.Width, fr.Height));
+                slot.Frame = copyFrame(fr, slot.Pixels.data());
+            }
+
+            std::lock_guard<std::mutex> l(Lock);
+            if(success)
+            {
+                slot.Position = std::move(Pending);
+                ++Count;
+            }
+            else
+                Ended = true;
+
+            Pending = std::move(next);
+            Produced.notify_all();
+
+            if(!success)
+                return;
+        }
+    }
+    catch(...)
+    {
+        std::lock_guard<std::mutex> l(Lock);
+        Error = std::current_exception();
+        Produced.notify_all();
+    }
+}
+
+const Codecstats *Decodeahead::codecStats() const
+{
+    return Source->codecStats();
+}
+
+bool Decodeahead::codecSkip(Frameskip mode)
+{
+    std::lock_guard<std::mutex> l(Lock);
+    if(Unsupported[static_cast<size_t>(mode)])
+        return false;
+
+    Skip = mode;
+    Skippending = true;
+    return true;
+}
+
+void Decodeahead::codecLogging(CodecLoglevel lvl, CodecLogger lg)
+{
+    paused([&]() { Source->codecLogging(lvl, std::move(lg)); });
+}
+
+void Decodeahead::codecFramepool(std::shared_ptr<Framepool> p)
+{
+    paused([&]()
+    {
+        Source->codecFramepool(p);
+        Buffers = std::move(p);
+    });
+}
+
+void Decodeahead::codecParameter(const std::string &parameter, const std::string &value)
+{
+    if(parameter == "prefetch")
+    {
+        size_t depth;
+        if(sscanf(value.c_str(), "%zu", &depth) != 1 || depth == 0)
+            throw GenericCodecError<WrongParameter>("decodeahead", parameter);
+
+        auto pos = tellFrame();
+        restart(static_cast<const AheadSeek&>(*pos).Position, depth);
+    }
+    else
+    {
+        paused([&]() { Source->codecParameter(parameter, value); });
+    }
+}
+
+bool Decodeahead::fetchFrame(Videoframe &f)
+{
+    std::unique_lock<std::mutex> l(Lock);
+
+    if(Holding) //release frame returned by the previous call
+    {
+        Ring[Head].Frame.Owner.reset();
+        Head = (Head + 1) % Ring.size();
+        --Count;
+        Holding = false;
+        Consumed.notify_all();
+    }
+
+    Produced.wait(l, [&]() { return Count > 0 || Ended || Error; });
+
+    if(Count == 0)
+    {
+        if(Error)
+            std::rethrow_exception(Error);
+        return false;
+    }
+
+    f = Ring[Head].Frame;
+    Holding = true;
+    return true;
+}
+
+std::unique_ptr<ISourceSeek> Decodeahead::tellFrame() const
+{
+    std::lock_guard<std::mutex> l(Lock);
+
+    auto s = std::make_unique<AheadSeek>();
+    size_t queued = Holding ? 1 : 0;
+    if(Count > queued)
+        s->Position = Ring[(Head + queued) % Ring.size()].Position;
+    else
+        s->Position = Pending;
+
+    return s;
+}
+
+void Decodeahead::seekFrame(const ISourceSeek &sk)
+{
+    const auto &s = static_cast<const AheadSeek&>(sk);
+    restart(s.Position, Ring.size() - 1);
+}
+
+}
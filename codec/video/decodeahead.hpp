@@ -0,0 +1,94 @@
+#pragma once
+
+#include <vector>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <exception>
+#include <functional>
+
+#include "codec.hpp"
+
+namespace mlib::codec::video
+{
+
+//
+// decode-ahead
+//
+// Runs the source decoder on a worker thread which keeps up to depth decoded frames
+// in a ring of owned buffers, so fetchFrame is a queue pop.
+// tellFrame/seekFrame flush the queue and restart the worker; seek objects must
+// stem from this decoder's tellFrame.
+// Frames already owned by the source are queued without copying. A frame pool is passed to the source
+// and used for the queue's buffers.
+// The source must not be used directly while it is wrapped.
+// Its logger is called from the worker thread.
+// codecStats returns the source's statistics. codecSkip is applied by the worker before it decodes
+// its next frame, frames already decoded ahead are still returned. It returns false once the source
+// has turned the mode down.
+//
+
+//
+// parameters
+//
+// - prefetch: number of frames decoded ahead, default: 4
+// All other parameters are passed to the source.
+//
+
+class Decodeahead : public IVideoDecodec
+{
+public:
+    Decodeahead(IVideoDecodec &source, size_t depth = 4);
+    ~Decodeahead();
+
+    void codecLogging(CodecLoglevel, CodecLogger) override;
+    void codecParameter(const std::string &parameter, const std::string &value) override;
+
+    bool fetchFrame(Videoframe&) override;
+
+    std::unique_ptr<ISourceSeek> tellFrame() const override;
+    void seekFrame(const ISourceSeek&) override;
+
+    void codecFramepool(std::shared_ptr<Framepool>) override;
+    const Codecstats *codecStats() const override;
+    bool codecSkip(Frameskip mode) override;
+
+    Decodeahead(Decodeahead&&) = delete;
+    Decodeahead(const Decodeahead&) = delete;
+    Decodeahead &operator=(Decodeahead&&) = delete;
+    Decodeahead &operator=(const Decodeahead&) = delete;
+
+private:
+    struct Slot
+    {
+        std::vector<char> Pixels;
+        Videoframe Frame;
+        std::shared_ptr<const ISourceSeek> Position;
+    };
+
+    void start();
+    void stop();
+    void paused(const std::function<void()> &f); //runs f with the worker stopped, restarting it even if f throws
+    void restart(std::shared_ptr<const ISourceSeek> position, size_t depth);
+    void work();
+
+    IVideoDecodec *Source;
+    std::shared_ptr<Framepool> Buffers;
+
+    std::vector<Slot> Ring;
+    size_t Head, Count;
+    bool Holding, Ended, Stopping;
+    std::shared_ptr<const ISourceSeek> Pending;
+    std::exception_ptr Error;
+
+    Frameskip Skip = Frameskip::None;
+    bool Skippending = false;
+    bool Unsupported[3] = {}; //skip modes the source turned down
+
+    mutable std::mutex Lock;
+    std::condition_variable Produced, Consumed;
+    std::thread Worker;
+};
+
+}
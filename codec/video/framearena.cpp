@@ -0,0 +1,148 @@
+#include "framearena.hpp"
+
+#include <mlib/error/nativeerror.hpp>
+
+#ifdef MLIB_PLATFORM_WIN32
+#include <Windows.h>
+#else
+#include <sys/types.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#include <cstdlib>
+#include <cerrno>
+#endif
+
+#include <algorithm>
+#include <string>
+
+namespace mlib::codec::video
+{
+
+static constexpr size_t Hugepage = 2 * 1024 * 1024;
+static constexpr size_t Alignment = 64;
+
+static size_t roundUp(size_t n, size_t to)
+{
+    return (n + to - 1) / to * to;
+}
+
+Framearena::Framearena(Arenabacking backing, size_t chunksize)
+    : Backing(backing), Chunksize(roundUp(std::max<size_t>(chunksize, 1), Hugepage)), Reserved(0)
+{
+#ifndef MLIB_PLATFORM_WIN32
+    File = -1;
+    Filesize = 0;
+
+    if(Backing == Arenabacking::Tempfile)
+    {
+        const char *dir = std::getenv("TMPDIR");
+        std::string path = std::string(dir && *dir ? dir : "/tmp") + "/mlib-frames-XXXXXX";
+
+        File = mkstemp(path.data());
+        if(File < 0)
+            throw ArenaError(" (tempfile) (" + error::formatError(errno) + ")");
+        unlink(path.c_str());
+    }
+#endif
+}
+
+Framearena::~Framearena()
+{
+    for(auto &c : Chunks)
+    {
+#ifdef MLIB_PLATFORM_WIN32
+        if(c.Mapping)
+        {
+            UnmapViewOfFile(c.Base);
+            CloseHandle(c.Mapping);
+        }
+        else
+            VirtualFree(c.Base, 0, MEM_RELEASE);
+#else
+        munmap(c.Base, c.Size);
+#endif
+    }
+
+#ifndef MLIB_PLATFORM_WIN32
+    if(File >= 0)
+        close(File);
+#endif
+}
+
+void *Framearena::allocate(size_t bytes)
+{
+    Chunk *c = Chunks.empty() ? nullptr : &Chunks.back();
+    if(c)
+        c->Used = roundUp(c->Used, Alignment);
+
+    if(!c || bytes > c->Size - c->Used)
+        c = &newChunk(bytes);
+
+    void *ptr = c->Base + c->Used;
+    c->Used += bytes;
+    return ptr;
+}
+
+Framearena::Chunk &Framearena::newChunk(size_t bytes)
+{
+    Chunk c{};
+    c.Size = std::max(Chunksize, roundUp(bytes, Hugepage));
+
+#ifdef MLIB_PLATFORM_WIN32
+    if(Backing == Arenabacking::Tempfile)
+    {
+        auto size = static_cast<uint64_t>(c.Size);
+        c.Mapping = CreateFileMappingW(INVALID_HANDLE_VALUE, nullptr, PAGE_READWRITE,
+            static_cast<DWORD>(size >> 32), static_cast<DWORD>(size), nullptr);
+        if(c.Mapping)
+        {
+            c.Base = static_cast<char*>(MapViewOfFile(c.Mapping, FILE_MAP_ALL_ACCESS, 0, 0, c.Size));
+            if(!c.Base)
+                CloseHandle(c.Mapping);
+        }
+    }
+    else
+        c.Base = static_cast<char*>(VirtualAlloc(nullptr, c.Size, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE));
+
+    if(!c.Base)
+        throw ArenaError(" (allocate) (" + error::formatError(GetLastError()) + ")");
+#else
+    if(Backing == Arenabacking::Tempfile)
+    {
+        if(ftruncate(File, static_cast<off_t>(Filesize + c.Size)) != 0)
+            throw ArenaError(" (allocate) (" + error::formatError(errno) + ")");
+
+        void *m = mmap(nullptr, c.Size, PROT_READ | PROT_WRITE, MAP_SHARED, File, static_cast<off_t>(Filesize));
+        if(m == MAP_FAILED)
+            throw ArenaError(" (allocate) (" + error::formatError(errno) + ")");
+
+        c.Base = static_cast<char*>(m);
+        Filesize += c.Size;
+    }
+    else
+    {
+        //over-allocate to trim the mapping to huge page alignment
+        void *m = mmap(nullptr, c.Size + Hugepage, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if(m == MAP_FAILED)
+            throw ArenaError(" (allocate) (" + error::formatError(errno) + ")");
+
+        auto raw = static_cast<char*>(m);
+        auto head = roundUp(reinterpret_cast<uintptr_t>(raw), Hugepage) - reinterpret_cast<uintptr_t>(raw);
+        if(head)
+            munmap(raw, head);
+        if(Hugepage - head)
+            munmap(raw + head + c.Size, Hugepage - head);
+
+        c.Base = raw + head;
+#ifdef MADV_HUGEPAGE
+        madvise(c.Base, c.Size, MADV_HUGEPAGE);
+#endif
+    }
+#endif
+
+    Reserved += c.Size;
+    Chunks.push_back(c);
+    return Chunks.back();
+}
+
+}
@@ -0,0 +1,73 @@
+#pragma once
+
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+#include <mlib/platform.hpp>
+
+#include "codec.hpp"
+
+namespace mlib::codec::video
+{
+
+//
+// exceptions
+//
+
+struct ArenaError : public CodecError
+{
+    ArenaError(const std::string &e) : CodecError(".framearena" + e) {}
+};
+
+//
+// frame arena
+//
+// Allocates pixel buffers from large chunks which are released together with the arena.
+// - Memory backing uses anonymous memory aligned for and advised to use huge pages.
+// - Tempfile backing maps chunks of a deleted temporary file, so the system can write
+//   pages back and drop them under memory pressure instead of swapping.
+//   On Windows, chunks are backed by the paging file.
+// allocate returns a 64 byte aligned buffer, allocations larger than a chunk get their own chunk.
+//
+
+enum class Arenabacking { Memory, Tempfile };
+
+class Framearena
+{
+public:
+    Framearena(Arenabacking backing = Arenabacking::Memory, size_t chunksize = 64 * 1024 * 1024);
+    ~Framearena();
+
+    void *allocate(size_t bytes);
+
+    Arenabacking backing() const { return Backing; }
+    size_t reservedBytes() const { return Reserved; }
+
+    Framearena(Framearena&&) = delete;
+    Framearena(const Framearena&) = delete;
+    Framearena &operator=(Framearena&&) = delete;
+    Framearena &operator=(const Framearena&) = delete;
+
+private:
+    struct Chunk
+    {
+        char *Base;
+        size_t Size, Used;
+#ifdef MLIB_PLATFORM_WIN32
+        void *Mapping;
+#endif
+    };
+
+    Chunk &newChunk(size_t bytes);
+
+    Arenabacking Backing;
+    size_t Chunksize, Reserved;
+    std::vector<Chunk> Chunks;
+
+#ifndef MLIB_PLATFORM_WIN32
+    int File;
+    uint64_t Filesize;
+#endif
+};
+
+}
@@ -0,0 +1,154 @@
+#include "framepool.hpp"
+#include "frameutil.hpp"
+
+#include <unordered_map>
+#include <vector>
+#include <mutex>
+#include <new>
+#include <cstring>
+
+namespace mlib::codec::video
+{
+
+static constexpr std::align_val_t BufferAlignment{ 64 };
+
+//
+// size classes
+//
+
+static size_t classSize(size_t n)
+{
+    const size_t minimum = 4096;
+    if(n <= minimum)
+        return minimum;
+
+    size_t base = minimum;
+    while(base * 2 < n)
+        base *= 2;
+
+    size_t step = base / 4;
+    return base + (n - base + step - 1) / step * step;
+}
+
+//
+// pool
+//
+
+struct Framepool::State
+{
+    size_t Maxidle;
+    std::unordered_map<size_t, std::vector<void*>> Idle;
+    mutable std::mutex Lock;
+
+    ~State()
+    {
+        for(auto &[siz, blocks] : Idle)
+        {
+            for(void *b : blocks)
+                operator delete(b, BufferAlignment);
+        }
+    }
+
+    void release(void *block, size_t siz)
+    {
+        {
+            std::lock_guard<std::mutex> l(Lock);
+            auto &blocks = Idle[siz];
+            if(blocks.size() < Maxidle)
+            {
+                blocks.push_back(block);
+                return;
+            }
+        }
+        operator delete(block, BufferAlignment);
+    }
+};
+
+Framepool::Framepool(size_t maxidle) : Shared(std::make_shared<State>())
+{
+    Shared->Maxidle = maxidle;
+}
+
+void *Framepool::take(size_t siz)
+{
+    void *block = nullptr;
+    {
+        std::lock_guard<std::mutex> l(Shared->Lock);
+        if(auto it = Shared->Idle.find(siz); it != Shared->Idle.end() && !it->second.empty())
+        {
+            block = it->second.back();
+            it->second.pop_back();
+        }
+    }
+
+    if(!block)
+        block = operator new(siz, BufferAlignment);
+
+    return block;
+}
+
+std::shared_ptr<char> Framepool::acquire(size_t bytes)
+{
+    size_t siz = classSize(bytes);
+    void *block = take(siz);
+
+    auto state = Shared; //the deleter keeps the free lists alive
+    return std::shared_ptr<char>(static_cast<char*>(block), [state, siz](char *p) { state->release(p, siz); });
+}
+
+//raw blocks start with a header holding their size class
+static constexpr size_t RawHeader = 64;
+
+void *Framepool::allocate(size_t bytes)
+{
+    size_t siz = classSize(bytes + RawHeader);
+    auto block = static_cast<char*>(take(siz));
+    *reinterpret_cast<size_t*>(block) = siz;
+    return block + RawHeader;
+}
+
+void *Framepool::reallocate(void *ptr, size_t bytes)
+{
+    if(!ptr)
+        return allocate(bytes);
+
+    auto block = static_cast<char*>(ptr) - RawHeader;
+    size_t usable = *reinterpret_cast<size_t*>(block) - RawHeader;
+    if(bytes <= usable)
+        return ptr;
+
+    void *n = allocate(bytes);
+    std::memcpy(n, ptr, usable);
+    release(ptr);
+    return n;
+}
+
+void Framepool::release(void *ptr)
+{
+    if(!ptr)
+        return;
+
+    auto block = static_cast<char*>(ptr) - RawHeader;
+    Shared->release(block, *reinterpret_cast<size_t*>(block));
+}
+
+size_t Framepool::idleBytes() const
+{
+    std::lock_guard<std::mutex> l(Shared->Lock);
+
+    size_t n = 0;
+    for(const auto &[siz, blocks] : Shared->Idle)
+        n += siz * blocks.size();
+
+    return n;
+}
+
+Videoframe copyFrame(const Videoframe &src, Framepool &pool)
+{
+    auto buf = pool.acquire(frameBytes(src.Format, src.Width, src.Height));
+    Videoframe f = copyFrame(src, buf.get());
+    f.Owner = std::move(buf);
+    return f;
+}
+
+}
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <memory>
+#include <cstddef>
+
+#include "codec.hpp"
+
+namespace mlib::codec::video
+{
+
+//
+// frame pool
+//
+// Hands out reference counted pixel buffers from size classes spaced a quarter power of two apart.
+// A buffer returns to its size class when the last reference drops, which may happen
+// after the pool has been destroyed. At most maxidle buffers are kept per size class.
+// Thread-safe.
+// - acquire returns a buffer of at least the given number of bytes, aligned to 64 bytes.
+// - allocate, reallocate and release manage raw buffers like malloc, realloc and free,
+//   for use by libraries taking allocation functions. They share the size classes.
+// - copyFrame copies a frame tightly packed into a buffer and sets the copy's Owner.
+//
+
+class Framepool
+{
+public:
+    Framepool(size_t maxidle = 8);
+
+    std::shared_ptr<char> acquire(size_t bytes);
+    size_t idleBytes() const;
+
+    void *allocate(size_t bytes);
+    void *reallocate(void *ptr, size_t bytes);
+    void release(void *ptr);
+
+private:
+    void *take(size_t siz);
+
+    struct State;
+    std::shared_ptr<State> Shared;
+};
+
+Videoframe copyFrame(const Videoframe &src, Framepool &pool);
+
+}
@@ -1,9 +1,11 @@
 #include "frameseq.hpp"
+#include "frameutil.hpp"
 
 #include <utility>
 #include <cassert>
 #include <cstring>
 #include <memory>
+#include <algorithm>
 
 namespace mlib::codec::video
 {
@@ -12,55 +14,20 @@ namespace mlib::codec::video
 // frame sequence
 //
 
-static void fill(char *&ptr, const void *data, size_t n)
+Frameseq::Frameseq(Arenabacking backing) : Arena(backing)
 {
-    std::memcpy(ptr, data, n);
-    ptr += n;
 }
 
 void Frameseq::append(const Videoframe &f)
 {
-    Frame newf;
-    newf.Info = f;
-
-    if(f.Format == Pixelformat::YUV12P)
-    {
-        auto npxY = (f.Width + f.Linestrides[0]) * f.Height;
-        auto npxU = ((f.Width + f.Linestrides[1]) * f.Height + 3) / 4;
-        auto npxV = ((f.Height + f.Linestrides[2]) * f.Height + 3) / 4;
-        newf.Pixels.resize(npxY + npxU + npxV);
-
-        auto ptr = newf.Pixels.data();
-
-        newf.Info.Planes[0] = ptr;
-        fill(ptr, f.Planes[0], npxY);
-        newf.Info.Planes[1] = ptr;
-        fill(ptr, f.Planes[1], npxU);
-        newf.Info.Planes[2] = ptr;
-        fill(ptr, f.Planes[2], npxV);
-    }
-    else if(f.Format == Pixelformat::RGBA32I)
-    {
-        auto npx = (f.Width + f.Linestrides[0]) * f.Height * 4;
-        newf.Pixels.resize(npx);
-
-        auto ptr = newf.Pixels.data();
-        newf.Info.Planes[0] = ptr;
-        fill(ptr, f.Planes[0], npx);
-    }
-    else if(f.Format == Pixelformat::RGB24I)
+    if(f.Owner && Arena.backing() == Arenabacking::Memory) //owned frames are kept by reference
+        Frames.push_back(f);
+    else
     {
-        auto npx = (f.Width + f.Linestrides[0]) * f.Height * 3;
-        newf.Pixels.resize(npx);
-
-        auto ptr = newf.Pixels.data();
-        newf.Info.Planes[0] = ptr;
-        fill(ptr, f.Planes[0], npx);
+        auto newf = copyFrame(f, Arena.allocate(frameBytes(f.Format, f.Width, f.Height)));
+        newf.Owner.reset();
+        Frames.push_back(std::move(newf));
     }
-    else
-        assert(false);
-
-    Frames.push_back(std::move(newf));
 }
 
 //
@@ -94,6 +61,15 @@ bool FrameseqDecodec::fetchFrame(Videoframe &fr)
     return true;
 }
 
+size_t FrameseqDecodec::fetchFrames(Videoframe *frames, size_t count)
+{
+    size_t n = std::min(count, Source->length() - std::min(Currframe, Source->length()));
+    for(size_t i = 0; i < n; ++i)
+        frames[i] = (*Source)[Currframe++];
+
+    return n;
+}
+
 std::unique_ptr<ISourceSeek> FrameseqDecodec::tellFrame() const
 {
     auto s = std::make_unique<Seek>();
@@ -107,4 +83,4 @@ void FrameseqDecodec::seekFrame(const ISourceSeek &sk)
     Currframe = s.Framepos;
 }
 
-}
\ No newline at end of file
+}
\ No newline at end of file
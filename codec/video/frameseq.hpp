@@ -3,6 +3,7 @@
 #include <vector>
 
 #include "codec.hpp"
+#include "framearena.hpp"
 
 namespace mlib::codec::video
 {
@@ -10,16 +11,20 @@ namespace mlib::codec::video
 //
 // frame sequence
 //
+// append copies a frame's pixels into an arena (see Framearena), unless the frame is owned
+// (see Videoframe::Owner) and the arena is held in memory. With Tempfile backing, all
+// frames are copied, so long sequences can be paged out.
+//
 
 class Frameseq
 {
 public:
-    Frameseq() = default;
+    Frameseq(Arenabacking backing = Arenabacking::Memory);
     void append(const Videoframe &f);
 
     size_t length() const { return Frames.size(); }
 
-    const Videoframe &operator[](size_t idx) const { return Frames[idx].Info; }
+    const Videoframe &operator[](size_t idx) const { return Frames[idx]; }
 
     Frameseq(Frameseq&&) = delete;
     Frameseq(const Frameseq&) = delete;
@@ -27,17 +32,16 @@ public:
     Frameseq &operator=(const Frameseq&) = delete;
     
 private:
-    struct Frame
-    {
-        Videoframe Info;
-        std::vector<char> Pixels;
-    };
-    std::vector<Frame> Frames;
+    Framearena Arena;
+    std::vector<Videoframe> Frames;
 };
 
 //
 // frame sequence decoder
 //
+// Returns the frames of a sequence, which stay valid as long as the sequence.
+// fetchFrames copies a batch of them without further calls.
+//
 
 class FrameseqDecodec : public IVideoDecodec
 {
@@ -48,6 +52,7 @@ public:
     void codecParameter(const std::string &parameter, const std::string &value) override;
 
     bool fetchFrame(Videoframe&) override;
+    size_t fetchFrames(Videoframe *frames, size_t count) override;
 
     std::unique_ptr<ISourceSeek> tellFrame() const override;
     void seekFrame(const ISourceSeek&) override;
@@ -57,4 +62,4 @@ private:
     size_t Currframe;
 };
 
-}
\ No newline at end of file
+}
\ No newline at end of file
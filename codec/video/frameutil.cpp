@@ -0,0 +1,131 @@
+#include "frameutil.hpp"
+
+#include <cassert>
+#include <cstring>
+
+namespace mlib::codec::video
+{
+
+size_t planeCount(Pixelformat fmt)
+{
+    switch(fmt)
+    {
+    case Pixelformat::YUV12P: return 3;
+    case Pixelformat::RGBA32I: return 1;
+    case Pixelformat::RGB24I: return 1;
+    case Pixelformat::YUV12S: return 2;
+    case Pixelformat::BGRA32I: return 1;
+    case Pixelformat::YUV24P: return 3;
+    case Pixelformat::Y8P: return 1;
+    case Pixelformat::RGB16I: return 1;
+    }
+
+    assert(false);
+    return 0;
+}
+
+size_t planeRowbytes(Pixelformat fmt, unsigned int width, size_t plane)
+{
+    switch(fmt)
+    {
+    case Pixelformat::YUV12P: return plane == 0 ? width : (width + 1) / 2;
+    case Pixelformat::RGBA32I: return static_cast<size_t>(width) * 4;
+    case Pixelformat::RGB24I: return static_cast<size_t>(width) * 3;
+    case Pixelformat::YUV12S: return plane == 0 ? width : (width + 1) / 2 * 2;
+    case Pixelformat::BGRA32I: return static_cast<size_t>(width) * 4;
+    case Pixelformat::YUV24P: return width;
+    case Pixelformat::Y8P: return width;
+    case Pixelformat::RGB16I: return static_cast<size_t>(width) * 2;
+    }
+
+    assert(false);
+    return 0;
+}
+
+unsigned int planeRows(Pixelformat fmt, unsigned int height, size_t plane)
+{
+    if((fmt == Pixelformat::YUV12P || fmt == Pixelformat::YUV12S) && plane != 0)
+        return (height + 1) / 2;
+
+    return height;
+}
+
+size_t planeStride(const Videoframe &f, size_t plane)
+{
+    if(f.Linestrides[plane] != 0)
+        return f.Linestrides[plane];
+
+    return planeRowbytes(f.Format, f.Width, plane);
+}
+
+//stride of a plane laid out with the stride of the first plane
+static size_t layoutStride(Pixelformat fmt, unsigned int width, size_t stride, size_t plane)
+{
+    if(stride == 0)
+        return planeRowbytes(fmt, width, plane);
+    if(plane == 0)
+        return stride;
+
+    return planeRowbytes(fmt, static_cast<unsigned int>(stride), plane); //planar formats have one byte luma samples
+}
+
+size_t frameBytes(Pixelformat fmt, unsigned int width, unsigned int height, size_t stride)
+{
+    size_t n = 0;
+    for(size_t p = 0; p < planeCount(fmt); ++p)
+        n += layoutStride(fmt, width, stride, p) * planeRows(fmt, height, p);
+
+    return n;
+}
+
+Videoframe layoutFrame(Pixelformat fmt, unsigned int width, unsigned int height, void *dest, size_t stride)
+{
+    Videoframe f{};
+    f.Format = fmt;
+    f.Width = width;
+    f.Height = height;
+
+    auto ptr = static_cast<char*>(dest);
+    for(size_t p = 0; p < planeCount(fmt); ++p)
+    {
+        auto rowbytes = layoutStride(fmt, width, stride, p);
+
+        f.Planes[p] = ptr;
+        f.Linestrides[p] = rowbytes;
+        ptr += rowbytes * planeRows(fmt, height, p);
+    }
+
+    return f;
+}
+
+Videoframe copyFrame(const Videoframe &src, void *dest)
+{
+    Videoframe f = src;
+    auto ptr = static_cast<char*>(dest);
+
+    for(size_t p = 0; p < planeCount(src.Format); ++p)
+    {
+        auto rowbytes = planeRowbytes(src.Format, src.Width, p);
+        auto rows = planeRows(src.Format, src.Height, p);
+        auto stride = planeStride(src, p);
+
+        f.Planes[p] = ptr;
+        f.Linestrides[p] = rowbytes;
+
+        if(stride == rowbytes)
+        {
+            std::memcpy(ptr, src.Planes[p], rowbytes * rows);
+            ptr += rowbytes * rows;
+        }
+        else
+        {
+            auto srcrow = static_cast<const char*>(src.Planes[p]);
+            for(unsigned int y = 0; y < rows; ++y, srcrow += stride, ptr += rowbytes)
+                std::memcpy(ptr, srcrow, rowbytes);
+        }
+    }
+
+    return f;
+}
+
+}
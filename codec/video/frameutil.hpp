@@ -0,0 +1,36 @@
+#pragma once
+
+#include <cstddef>
+
+#include "codec.hpp"
+
+namespace mlib::codec::video
+{
+
+//
+// frame layout helpers
+//
+// - planeCount returns the number of planes of a pixel format.
+// - planeRowbytes returns the number of bytes of a tightly packed row of a plane.
+// - planeRows returns the number of rows of a plane.
+// - planeStride returns a frame's line stride of a plane; a stride of 0 denotes tightly packed rows.
+// - frameBytes returns the number of bytes a frame occupies, tightly packed or laid out with
+//   a stride as by layoutFrame.
+// - layoutFrame lays out a frame in dest, which must hold frameBytes bytes if tightly packed.
+//   A stride other than 0 applies to the first plane, further planes of planar formats follow
+//   each other with their strides scaled like their row widths.
+// - copyFrame copies a frame's pixels tightly packed to dest, which must hold frameBytes bytes.
+//   Returns a frame referring to dest.
+//
+
+size_t planeCount(Pixelformat fmt);
+size_t planeRowbytes(Pixelformat fmt, unsigned int width, size_t plane);
+unsigned int planeRows(Pixelformat fmt, unsigned int height, size_t plane);
+size_t planeStride(const Videoframe &f, size_t plane);
+size_t frameBytes(Pixelformat fmt, unsigned int width, unsigned int height, size_t stride = 0);
+
+Videoframe layoutFrame(Pixelformat fmt, unsigned int width, unsigned int height, void *dest, size_t stride = 0);
+
+Videoframe copyFrame(const Videoframe &src, void *dest);
+
+}
@@ -1,10 +1,13 @@
 #include "decodeh264.hpp"
+#include "implh264.hpp"
+#include "indexh264.hpp"
+#include "../framepool.hpp"
 
-#include <wels/codec_api.h>
-#include <wels/codec_def.h>
 #include <wels/codec_ver.h>
 
 #include <utility>
+#include <map>
+#include <chrono>
 #include <cassert>
 
 namespace mlib::codec::video::h264
@@ -14,131 +17,158 @@ namespace mlib::codec::video::h264
 // impl
 //
 
-struct Decoder::ImplData
-{    
-    struct FrameSeekinfo : public ISourceSeek
+static void initialize(ISVCDecoder *dec)
+{
+    SDecodingParam d = { 0 };
+    d.bParseOnly = false;
+    d.eEcActiveIdc = ERROR_CON_DISABLE;
+    d.sVideoProperty.eVideoBsType = VIDEO_BITSTREAM_DEFAULT;
+    if(long e = dec->Initialize(&d); e != 0)
+        throw ErrorCode(e);
+}
+
+Decoder::ImplData::ImplData(size_t capacity) : Loglevel(CodecLoglevel::None), Reader(capacity)
+{
+    if(long e = WelsCreateDecoder(&Decoder); e != 0)
+        throw ErrorCode(e);
+
+    try
+    {
+        initialize(Decoder);
+    }
+    catch(...)
     {
-        std::unique_ptr<ISourceSeek> BufferSeekinfo;
-        size_t BufferOffset;
-        size_t BufferSize;
-    };
+        WelsDestroyDecoder(Decoder);
+        throw;
+    }
+}
+Decoder::ImplData::~ImplData()
+{
+    Decoder->Uninitialize();
+    WelsDestroyDecoder(Decoder);
+}
 
-    CodecLogger Logger;
-    ICodecSourcebuffer *Source;
-    ISVCDecoder *Decoder;
+void Decoder::ImplData::reset()
+{
+    Decoder->Uninitialize();
+    initialize(Decoder);
+    Failed = false;
 
-    const void *SourcebufferBegin;
-    size_t SourcebufferLength, CurrentOffset;
+    if(Logger)
+        logging(Loglevel, Logger);
+}
 
-    size_t BufferCapacity;
+void Decoder::ImplData::logging(CodecLoglevel l, CodecLogger h)
+{
+    Loglevel = l;
+    Logger = std::move(h);
+    int loglevel = l == CodecLoglevel::None ? WELS_LOG_QUIET : l == CodecLoglevel::Info ? WELS_LOG_DEFAULT : WELS_LOG_DEBUG;
+    Decoder->SetOption(DECODER_OPTION_TRACE_LEVEL, &loglevel);
 
-    ImplData(ICodecSourcebuffer &source, size_t capacity) : Source(&source), BufferCapacity(capacity)
-    {
-        if(long e = WelsCreateDecoder(&Decoder); e != 0)
-            throw ErrorCode(e);
+    void *ctx = this;
+    Decoder->SetOption(DECODER_OPTION_TRACE_CALLBACK_CONTEXT, &ctx);
 
-        SDecodingParam d = { 0 };
-        d.bParseOnly = false;
-        d.eEcActiveIdc = ERROR_CON_DISABLE;
-        d.sVideoProperty.eVideoBsType = VIDEO_BITSTREAM_DEFAULT;
-        if(long e = Decoder->Initialize(&d); e != 0)
-            throw ErrorCode(e);
+    WelsTraceCallback cb = tracecb;
+    Decoder->SetOption(DECODER_OPTION_TRACE_CALLBACK, &cb);
+}
 
-        size_t curlen;
-        std::tie(std::ignore, curlen) = Source->bufferProperties();
+void Decoder::ImplData::tracecb(void *ctx, int level, const char *msg)
+{
+    static_cast<ImplData*>(ctx)->Logger(msg);
+}
 
-        if(curlen < BufferCapacity)
-            Source->extendBuffer(BufferCapacity - curlen);
+void Decoder::ImplData::fillFrame(Videoframe &f, const SBufferInfo &bufinfo, unsigned char *const *picptrs)
+{
+    f.Format = Pixelformat::YUV12P;
+    f.Width = bufinfo.UsrData.sSystemBuffer.iWidth;
+    f.Height = bufinfo.UsrData.sSystemBuffer.iHeight;
+    f.Planes[0] = picptrs[0];
+    f.Planes[1] = picptrs[1];
+    f.Planes[2] = picptrs[2];
+    f.Linestrides[0] = bufinfo.UsrData.sSystemBuffer.iStride[0];
+    f.Linestrides[1] = bufinfo.UsrData.sSystemBuffer.iStride[1];
+    f.Linestrides[2] = bufinfo.UsrData.sSystemBuffer.iStride[1];
+    f.Owner.reset();
+}
 
-        std::tie(SourcebufferBegin, SourcebufferLength) = Source->bufferProperties();
-        CurrentOffset = 0;
-    }
-    ~ImplData()
-    {
-        Decoder->Uninitialize();
-        WelsDestroyDecoder(Decoder);
-    }
+bool Decoder::ImplData::fetchFrame(Videoframe &f)
+{
+    SBufferInfo bufinfo = { 0 };
+    unsigned char *picptrs[3];
 
-    static void tracecb(void *ctx, int level, const char *msg)
+    while(bufinfo.iBufferStatus != 1)
     {
-        static_cast<ImplData*>(ctx)->Logger(msg);
-    }
+        const auto[success, start, len] = Reader.nextUnit();
 
-    static bool isMarker(const void *beg, size_t off)
-    {
-        auto buf = static_cast<const unsigned char*>(beg);
-        return buf[off] == 0 && buf[off + 1] == 0 && buf[off + 2] == 0 && buf[off + 3] == 1; //signature: 00 00 00 01
-    }
+        if(!success)
+            return false;
 
-    std::tuple<bool, size_t, size_t> nextNALUnit(size_t off)
-    {
-        if(SourcebufferLength < 4 || off >= SourcebufferLength)
-            return { false, 0, 0 };
+        const unsigned char *unit = Reader.unitData(start);
+        auto type = nalType(unit, len);
+        Codecstats::add(Stats.Units);
 
-        size_t startoff = off; //begin at position where we stopped last time
-        off += 4; //jump over start bytes of current NAL unit
+        bool slice = type == Nalunit::Slice || type == Nalunit::IDR;
+        bool picturestart = slice && nalPicturestart(unit, len);
 
-        for(; off < SourcebufferLength - 3; ++off) //search signature of next unit until end of buffer
+        if(skipUnit(unit, len, type))
         {
-            if(isMarker(SourcebufferBegin, off)) 
-                return { true, startoff, off - startoff }; //return success, start offset into buffer, length of found unit
+            if(picturestart)
+                Codecstats::add(Stats.Skipped);
+            continue;
         }
 
-        auto remaininglen = SourcebufferLength - startoff; //signature not found -> pull more bytes
-        auto advance = startoff;
-        size_t nread;
-        std::tie(SourcebufferBegin, nread) = Source->advanceBuffer(advance);
-
-        SourcebufferLength -= (advance - nread); //less data might have been read
+        Codecstats::add(Stats.BytesConsumed, len);
+        if(picturestart)
+            Failed = false;
 
-        off -= advance; //adjust offset to where we stopped
-
-        for(;;)
+        //pending output is no error, errors of other units lose no picture, a picture is dropped once
+        auto state = Decoder->DecodeFrameNoDelay(unit, static_cast<int>(len), picptrs, &bufinfo);
+        if((state & ~dsFramePending) != 0 && slice && !Failed)
         {
-            for(; off < SourcebufferLength - 3; ++off) //search signature of next unit until end of buffer
-            {
-                if(isMarker(SourcebufferBegin, off))
-                    return { true, 0, off }; //return success, start offset into buffer, length of found unit
-            }
-
-            //not found: unit might be longer than buffer -> extend buffer
-            std::tie(SourcebufferBegin, nread) = Source->extendBuffer(BufferCapacity);
-            SourcebufferLength += nread;
-
-            if(nread == 0) //no new data has been appended -> stream is empty, return last unit
-                return { true, 0, SourcebufferLength }; //no new data has been appendend -> stream is empty, return last unit
+            Codecstats::add(Stats.Dropped);
+            Failed = true;
         }
     }
 
-    bool fetchFrame(Videoframe &f)
-    {
-        SBufferInfo bufinfo = { 0 };
-        unsigned char *picptrs[3];
+    fillFrame(f, bufinfo, picptrs);
+    return true;
+}
 
-        while(bufinfo.iBufferStatus != 1)
-        {
-            const auto[success, start, len] = nextNALUnit(CurrentOffset);
-            CurrentOffset = start + len;
+bool Decoder::ImplData::skipUnit(const unsigned char *unit, size_t len, Nalunit type)
+{
+    bool slice = type == Nalunit::Slice || type == Nalunit::IDR;
 
-            if(success)
-                Decoder->DecodeFrameNoDelay(&static_cast<const unsigned char*>(SourcebufferBegin)[start], static_cast<int>(len), picptrs, &bufinfo);
-            else
-                return false;
-        }
+    if(Keyonly)
+        return type != Nalunit::SPS && type != Nalunit::PPS && type != Nalunit::IDR;
 
-        f.Format = Pixelformat::YUV12P;
-        f.Width = bufinfo.UsrData.sSystemBuffer.iWidth;
-        f.Height = bufinfo.UsrData.sSystemBuffer.iHeight;
-        f.Planes[0] = picptrs[0];
-        f.Planes[1] = picptrs[1];
-        f.Planes[2] = picptrs[2];
-        f.Linestrides[0] = bufinfo.UsrData.sSystemBuffer.iStride[0];
-        f.Linestrides[1] = bufinfo.UsrData.sSystemBuffer.iStride[1];
-        f.Linestrides[2] = bufinfo.UsrData.sSystemBuffer.iStride[1];
-
-        return true;
+    if(Skip == Frameskip::Keyframe)
+    {
+        if(type != Nalunit::IDR)
+            return slice;
+
+        Skip = Frameskip::None;
+        return false;
     }
-};
+
+    return Skip == Frameskip::Nonreference && slice && !nalReference(unit, len);
+}
+
+bool Decoder::ImplData::flushFrame(Videoframe &f)
+{
+    int remaining = 0;
+    Decoder->GetOption(DECODER_OPTION_NUM_OF_FRAMES_REMAINING_IN_BUFFER, &remaining);
+    if(remaining <= 0)
+        return false;
+
+    SBufferInfo bufinfo = { 0 };
+    unsigned char *picptrs[3];
+    Decoder->FlushFrame(picptrs, &bufinfo);
+    if(bufinfo.iBufferStatus != 1)
+        return false;
+
+    fillFrame(f, bufinfo, picptrs);
+    return true;
+}
 
 //
 // decoder
@@ -146,37 +176,53 @@ struct Decoder::ImplData
 
 
 Decoder::Decoder(ICodecSourcebuffer &source, std::vector<std::pair<std::string, std::string>> parameters)
+    : Decoder(source, parameters, nullptr)
+{
+}
+
+Decoder::Decoder(ICodecSourcebuffer &source, const std::vector<std::pair<std::string, std::string>> &parameters, std::unique_ptr<ImplData> impl)
 {
     size_t capacity = 1024 * 1024;
+    int keyonly = 0;
 
     for(const auto &[p, v] : parameters)
     {
         if(p == "bufcapacity")
         {
-            if(sscanf(v.c_str(), "%zu", &capacity) == 0 || capacity <= 4)
+            if(sscanf(v.c_str(), "%zu", &capacity) != 1 || capacity <= 4)
+                throw GenericError<WrongParameter>(p);
+        }
+        else if(p == "keyframes")
+        {
+            if(sscanf(v.c_str(), "%d", &keyonly) != 1)
                 throw GenericError<WrongParameter>(p);
         }
         else
             throw GenericError<UnknownParameter>(p);
     }
 
-    Impl = std::make_unique<ImplData>(source, capacity);
+    if(impl)
+    {
+        Impl = std::move(impl);
+        Impl->Reader.BufferCapacity = capacity;
+    }
+    else
+        Impl = std::make_unique<ImplData>(capacity);
+
+    Impl->Keyonly = keyonly != 0;
+
+    Impl->Counted = std::make_unique<Statsource>(source, Impl->Stats);
+    Impl->Reader.attach(*Impl->Counted);
 }
 Decoder::~Decoder()
 {
+    if(Recycle)
+        Recycle(std::move(Impl));
 }
 
 void Decoder::codecLogging(CodecLoglevel l, CodecLogger h)
 {
-    Impl->Logger = std::move(h);
-    int loglevel = l == CodecLoglevel::None ? WELS_LOG_QUIET : l == CodecLoglevel::Info ? WELS_LOG_DEFAULT : WELS_LOG_DEBUG;
-    Impl->Decoder->SetOption(DECODER_OPTION_TRACE_LEVEL, &loglevel);
-
-    void *ctx = Impl.get();
-    Impl->Decoder->SetOption(DECODER_OPTION_TRACE_CALLBACK_CONTEXT, &ctx);
-
-    WelsTraceCallback cb = ImplData::tracecb;
-    Impl->Decoder->SetOption(DECODER_OPTION_TRACE_CALLBACK, &cb);
+    Impl->logging(l, std::move(h));
 }
 
 void Decoder::codecParameter(const std::string &p, const std::string &v)
@@ -184,10 +230,18 @@ void Decoder::codecParameter(const std::string &p, const std::string &v)
     if(p == "bufcapacity")
     {
         size_t capacity;
-        if(sscanf(p.c_str(), "%zu", &capacity) == 0 || capacity <= 4)
+        if(sscanf(v.c_str(), "%zu", &capacity) != 1 || capacity <= 4)
             throw GenericError<WrongParameter>(p);
 
-        Impl->BufferCapacity = capacity;
+        Impl->Reader.BufferCapacity = capacity;
+    }
+    else if(p == "keyframes")
+    {
+        int keyonly;
+        if(sscanf(v.c_str(), "%d", &keyonly) != 1)
+            throw GenericError<WrongParameter>(p);
+
+        Impl->Keyonly = keyonly != 0;
     }
     else
         throw GenericError<UnknownParameter>(p);
@@ -195,35 +249,96 @@ void Decoder::codecParameter(const std::string &p, const std::string &v)
 
 bool Decoder::fetchFrame(Videoframe &f)
 {
-    return Impl->fetchFrame(f);
+    auto begin = std::chrono::steady_clock::now();
+    if(!Impl->fetchFrame(f))
+        return false;
+
+    if(Impl->Buffers) //openh264 owns its picture buffers -> copy
+        f = copyFrame(f, *Impl->Buffers);
+
+    Impl->Stats.addDecodetime(std::chrono::steady_clock::now() - begin);
+    Codecstats::add(Impl->Stats.Frames);
+    return true;
 }
 
 std::unique_ptr<ISourceSeek> Decoder::tellFrame() const
 {
-    auto inf = std::make_unique<ImplData::FrameSeekinfo>();
-    inf->BufferSeekinfo = Impl->Source->sourceTell();
-    inf->BufferOffset = Impl->CurrentOffset;
-    inf->BufferSize = Impl->SourcebufferLength;
-    return inf;
+    return Impl->Reader.tell();
 }
 
 void Decoder::seekFrame(const ISourceSeek &s)
 {
-    const ImplData::FrameSeekinfo &inf = static_cast<const ImplData::FrameSeekinfo&>(s);
-    Impl->Source->sourceSeek(*inf.BufferSeekinfo);
+    Impl->Reader.seek(static_cast<const Nalreader::Seekinfo&>(s));
+}
+
+void Decoder::codecFramepool(std::shared_ptr<Framepool> p)
+{
+    Impl->Buffers = std::move(p);
+}
+
+const Codecstats *Decoder::codecStats() const
+{
+    return &Impl->Stats;
+}
+
+bool Decoder::codecSkip(Frameskip mode)
+{
+    Impl->Skip = mode;
+    return true;
+}
+
+void Decoder::seekToFrame(const Index &index, uint64_t frame)
+{
+    const auto *key = index.keyframe(frame);
+    if(!key)
+        throw GenericError<WrongParameter>("seek frame " + std::to_string(frame));
 
-    if(auto siz = Impl->Source->bufferProperties().second; siz < inf.BufferSize)
-        Impl->Source->extendBuffer(inf.BufferSize - siz);
+    Impl->reset();
 
-    std::tie(Impl->SourcebufferBegin, Impl->SourcebufferLength) = Impl->Source->bufferProperties();
+    std::map<std::pair<Nalunit, unsigned int>, const Index::Entry*> sets; //latest parameter set of every id, SPS first
+    for(const auto &e : index.entries())
+    {
+        if(e.Offset >= key->Offset)
+            break;
+        if(e.Type == Nalunit::SPS || e.Type == Nalunit::PPS)
+            sets[{ e.Type, e.Id }] = &e;
+    }
 
-    if(Impl->SourcebufferLength != inf.BufferSize)
+    for(const auto &[id, e] : sets)
+    {
+        Impl->Reader.seekOffset(e->Offset);
+        const auto[success, start, len] = Impl->Reader.nextUnit();
+        if(!success)
+            throw GenericError<StreamUnexpectedEnd>("seek frame");
+
+        SBufferInfo bufinfo = { 0 };
+        unsigned char *picptrs[3];
+        Impl->Decoder->DecodeFrameNoDelay(Impl->Reader.unitData(start), static_cast<int>(len), picptrs, &bufinfo);
+    }
+
+    Impl->Reader.seekOffset(key->Offset);
+
+    //every picture up to the requested frame is decoded, skipped pictures would not be counted
+    auto keyonly = std::exchange(Impl->Keyonly, false);
+    auto skip = std::exchange(Impl->Skip, Frameskip::None);
+    try
+    {
+        Videoframe f;
+        for(auto n = frame - key->Frame; n > 0; --n) //decode forward to the requested frame
+        {
+            if(!Impl->fetchFrame(f))
+                throw GenericError<StreamUnexpectedEnd>("seek frame " + std::to_string(frame));
+        }
+    }
+    catch(...)
     {
-        Impl->SourcebufferLength = 0;
-        throw StreamUnexpectedEnd("seek frame");
+        Impl->Keyonly = keyonly;
+        Impl->Skip = skip;
+        throw;
     }
 
-    Impl->CurrentOffset = inf.BufferOffset;
+    Impl->Keyonly = keyonly;
+    Impl->Skip = skip;
 }
 
 }
\ No newline at end of file
@@ -2,6 +2,8 @@
 
 #include <string>
 #include <vector>
+#include <functional>
+#include <cstdint>
 
 #include "../codec.hpp"
 #include "common264.hpp"
@@ -9,16 +11,29 @@
 namespace mlib::codec::video::h264
 {
 
+class Index;
+
 //
 // H264 decoder
 //
 // Decodes H264 stream in AnnexB format.
+// - seekToFrame positions the decoder so that the next fetchFrame returns the given frame.
+//   It jumps to the nearest preceding IDR unit of an index built from the same stream, decodes the
+//   latest SPS and PPS of every id before it and decodes forward from there, with keyframes and
+//   codecSkip suspended. The source must support sourceSeekOffset.
+// - codecStats counts NAL units, source reads, pictures skipped by codecSkip or keyframes as skipped
+//   and pictures with slices openh264 failed to decode as dropped.
+// - codecSkip skips slices with nal_ref_idc 0 (Nonreference) or up to the next IDR unit (Keyframe).
+//   Parameter sets are always decoded.
 //
 
 //
 // parameters
 //
 // - bufcapacity: the internal's buffer size, default: 1MiB
+// - keyframes (0 or 1): only SPS, PPS and IDR units are decoded, so fetchFrame returns keyframes only.
+//   Other units are still scanned but not handed to openh264, skipped pictures count as skipped.
+//   Default: 0
 //
 
 class Decoder : public virtual IVideoDecodec
@@ -35,14 +50,27 @@ public:
     std::unique_ptr<ISourceSeek> tellFrame() const override;
     void seekFrame(const ISourceSeek&) override;
 
+    void codecFramepool(std::shared_ptr<Framepool>) override;
+    const Codecstats *codecStats() const override;
+    bool codecSkip(Frameskip mode) override;
+
+    void seekToFrame(const Index &index, uint64_t frame);
+
     Decoder(Decoder&&) = delete;
     Decoder(const Decoder&) = delete;
     Decoder &operator=(Decoder&&) = delete;
     Decoder &operator=(const Decoder&) = delete;
 
 private:
+    friend class GopDecoder;
+    friend class Decoderpool;
+
     struct ImplData;
+
+    Decoder(ICodecSourcebuffer &source, const std::vector<std::pair<std::string, std::string>> &parameters, std::unique_ptr<ImplData> impl);
+
     std::unique_ptr<ImplData> Impl;
+    std::function<void(std::unique_ptr<ImplData>)> Recycle; //returns Impl to a Decoderpool
 };
 
 }
\ No newline at end of file
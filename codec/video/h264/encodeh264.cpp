@@ -0,0 +1,358 @@
+#include "encodeh264.hpp"
+#include "../codecstats.hpp"
+#include "../frameutil.hpp"
+#include "../pxconv.hpp"
+
+#include <wels/codec_api.h>
+#include <wels/codec_def.h>
+
+#include <utility>
+#include <thread>
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+
+namespace mlib::codec::video::h264
+{
+
+using Clock = std::chrono::steady_clock;
+
+//openh264 encodes with at most MAX_THREADS_NUM threads, more are reduced with a warning
+constexpr unsigned int Maxthreads = 4;
+
+//
+// frame feed
+//
+// Hands the frame being encoded to a conversion.
+//
+
+struct Framefeed : public IVideoDecodec
+{
+    const Videoframe *Frame = nullptr;
+
+    void codecLogging(CodecLoglevel, CodecLogger) override {}
+    void codecParameter(const std::string &p, const std::string &) override { throw GenericError<UnknownParameter>(p); }
+
+    bool fetchFrame(Videoframe &f) override
+    {
+        if(!Frame)
+            return false;
+
+        f = *Frame;
+        Frame = nullptr;
+        return true;
+    }
+
+    std::unique_ptr<ISourceSeek> tellFrame() const override { throw GenericError<SeekUnsupported>("encoder input"); }
+    void seekFrame(const ISourceSeek &) override { throw GenericError<SeekUnsupported>("encoder input"); }
+};
+
+//
+// impl
+//
+
+enum class Ratecontrol { Lowlatency, Bitrate, Quality, Off };
+
+struct Encoder::ImplData
+{
+    mlib::stream::ISink *Sink;
+    ISVCEncoder *Encoder;
+    bool Configured = false;
+    unsigned int Width = 0, Height = 0;
+
+    unsigned int Bitrate = 8000000, Keyinterval = 120, Threads = 0, Convthreads = 1;
+    float Framerate = 60;
+    Ratecontrol Mode = Ratecontrol::Lowlatency;
+
+    CodecLoglevel Loglevel = CodecLoglevel::None;
+    CodecLogger Logger;
+
+    Framefeed Feed;
+    std::unique_ptr<Pxconv> Conv;
+
+    uint64_t Frame = 0;
+    bool Forcekey = false;
+    Framestats Last;
+    Codecstats Stats;
+
+    ImplData(mlib::stream::ISink &sink);
+    ~ImplData();
+
+    void configure(unsigned int width, unsigned int height);
+    void logging();
+    void setParameter(const std::string &p, const std::string &v);
+
+    static void tracecb(void *ctx, int level, const char *msg);
+};
+
+Encoder::ImplData::ImplData(mlib::stream::ISink &sink) : Sink(&sink)
+{
+    if(int e = WelsCreateSVCEncoder(&Encoder); e != 0 || !Encoder)
+        throw ErrorCode(e);
+}
+
+Encoder::ImplData::~ImplData()
+{
+    if(Configured)
+        Encoder->Uninitialize();
+    WelsDestroySVCEncoder(Encoder);
+}
+
+void Encoder::ImplData::configure(unsigned int width, unsigned int height)
+{
+    if(Configured)
+    {
+        Encoder->Uninitialize();
+        Configured = false;
+    }
+
+    //one slice per thread, each at least a row of macroblocks
+    unsigned int threads = Threads ? Threads : std::max(1u, std::thread::hardware_concurrency());
+    threads = std::max(1u, std::min({ threads, Maxthreads, (height + 15) / 16 }));
+
+    SEncParamExt param;
+    Encoder->GetDefaultParams(&param);
+    param.iUsageType = CAMERA_VIDEO_REAL_TIME;
+    param.iPicWidth = static_cast<int>(width);
+    param.iPicHeight = static_cast<int>(height);
+    param.iTargetBitrate = static_cast<int>(Bitrate);
+    param.fMaxFrameRate = Framerate;
+    param.uiIntraPeriod = Keyinterval;
+    param.iSpatialLayerNum = 1;
+    param.iTemporalLayerNum = 1;
+    param.iMultipleThreadIdc = static_cast<int>(threads);
+    param.bEnableFrameSkip = false;
+
+    switch(Mode)
+    {
+    case Ratecontrol::Lowlatency:
+        param.iRCMode = RC_BITRATE_MODE;
+        param.bEnableFrameSkip = true;
+        param.iMaxBitrate = static_cast<int>(Bitrate);
+        param.iNumRefFrame = 1;
+        param.iComplexityMode = LOW_COMPLEXITY;
+        break;
+    case Ratecontrol::Bitrate:
+        param.iRCMode = RC_BITRATE_MODE;
+        break;
+    case Ratecontrol::Quality:
+        param.iRCMode = RC_QUALITY_MODE;
+        break;
+    case Ratecontrol::Off:
+        param.iRCMode = RC_OFF_MODE;
+        break;
+    }
+
+    auto &layer = param.sSpatialLayers[0];
+    layer.iVideoWidth = param.iPicWidth;
+    layer.iVideoHeight = param.iPicHeight;
+    layer.fFrameRate = Framerate;
+    layer.iSpatialBitrate = param.iTargetBitrate;
+    if(Mode == Ratecontrol::Lowlatency)
+        layer.iMaxSpatialBitrate = param.iMaxBitrate;
+    layer.sSliceArgument.uiSliceMode = threads > 1 ? SM_FIXEDSLCNUM_SLICE : SM_SINGLE_SLICE;
+    layer.sSliceArgument.uiSliceNum = threads;
+
+    if(int e = Encoder->InitializeExt(&param); e != cmResultSuccess)
+        throw ErrorCode(e);
+
+    Configured = true;
+    Width = width;
+    Height = height;
+
+    if(Logger)
+        logging();
+}
+
+void Encoder::ImplData::logging()
+{
+    int loglevel = Loglevel == CodecLoglevel::None ? WELS_LOG_QUIET : Loglevel == CodecLoglevel::Info ? WELS_LOG_DEFAULT : WELS_LOG_DEBUG;
+    Encoder->SetOption(ENCODER_OPTION_TRACE_LEVEL, &loglevel);
+
+    void *ctx = this;
+    Encoder->SetOption(ENCODER_OPTION_TRACE_CALLBACK_CONTEXT, &ctx);
+
+    WelsTraceCallback cb = tracecb;
+    Encoder->SetOption(ENCODER_OPTION_TRACE_CALLBACK, &cb);
+}
+
+void Encoder::ImplData::tracecb(void *ctx, int level, const char *msg)
+{
+    static_cast<ImplData*>(ctx)->Logger(msg);
+}
+
+void Encoder::ImplData::setParameter(const std::string &p, const std::string &v)
+{
+    if(p == "ratecontrol")
+    {
+        if(v == "lowlatency")
+            Mode = Ratecontrol::Lowlatency;
+        else if(v == "bitrate")
+            Mode = Ratecontrol::Bitrate;
+        else if(v == "quality")
+            Mode = Ratecontrol::Quality;
+        else if(v == "off")
+            Mode = Ratecontrol::Off;
+        else
+            throw GenericError<WrongParameter>(p);
+        return;
+    }
+
+    if(p == "framerate")
+    {
+        if(sscanf(v.c_str(), "%f", &Framerate) != 1 || !(Framerate > 0))
+            throw GenericError<WrongParameter>(p);
+        return;
+    }
+
+    unsigned int n;
+    if(sscanf(v.c_str(), "%u", &n) != 1)
+        throw GenericError<WrongParameter>(p);
+
+    if(p == "bitrate")
+    {
+        if(n == 0 || n > INT32_MAX)
+            throw GenericError<WrongParameter>(p);
+        Bitrate = n;
+    }
+    else if(p == "keyinterval")
+        Keyinterval = n;
+    else if(p == "threads")
+        Threads = n;
+    else if(p == "convthreads")
+    {
+        Convthreads = n;
+        if(Conv)
+            Conv->codecParameter(p, v);
+    }
+    else
+        throw GenericError<UnknownParameter>(p);
+}
+
+//
+// encoder
+//
+
+Encoder::Encoder(mlib::stream::ISink &sink, std::vector<std::pair<std::string, std::string>> parameters)
+{
+    Impl = std::make_unique<ImplData>(sink);
+
+    for(const auto &[p, v] : parameters)
+        Impl->setParameter(p, v);
+}
+
+Encoder::~Encoder()
+{
+}
+
+void Encoder::codecLogging(CodecLoglevel l, CodecLogger h)
+{
+    Impl->Loglevel = l;
+    Impl->Logger = std::move(h);
+    Impl->logging();
+}
+
+void Encoder::codecParameter(const std::string &p, const std::string &v)
+{
+    Impl->setParameter(p, v);
+
+    if(p != "convthreads" && Impl->Configured) //set up again with the next frame
+    {
+        Impl->Encoder->Uninitialize();
+        Impl->Configured = false;
+    }
+}
+
+void Encoder::encodeFrame(const Videoframe &frame)
+{
+    auto begin = Clock::now();
+
+    Framestats st;
+    st.Frame = Impl->Frame++;
+
+    Videoframe f = frame;
+    if(f.Format != Pixelformat::YUV12P)
+    {
+        if(!Impl->Conv)
+        {
+            Impl->Conv = std::make_unique<Pxconv>(Impl->Feed, Pixelformat::YUV12P);
+            Impl->Conv->codecParameter("convthreads", std::to_string(Impl->Convthreads));
+        }
+
+        Impl->Feed.Frame = &frame;
+        Impl->Conv->fetchFrame(f);
+    }
+
+    auto converted = Clock::now();
+    st.Converttime = converted - begin;
+
+    if(!Impl->Configured || f.Width != Impl->Width || f.Height != Impl->Height)
+        Impl->configure(f.Width, f.Height);
+
+    SSourcePicture pic;
+    std::memset(&pic, 0, sizeof(pic));
+    pic.iColorFormat = videoFormatI420;
+    pic.iPicWidth = static_cast<int>(f.Width);
+    pic.iPicHeight = static_cast<int>(f.Height);
+    for(size_t i = 0; i < 3; ++i)
+    {
+        pic.iStride[i] = static_cast<int>(planeStride(f, i));
+        pic.pData[i] = static_cast<unsigned char*>(const_cast<void*>(f.Planes[i]));
+    }
+    pic.uiTimeStamp = static_cast<long long>(st.Frame * 1000 / Impl->Framerate);
+
+    if(Impl->Forcekey)
+    {
+        Impl->Encoder->ForceIntraFrame(true);
+        Impl->Forcekey = false;
+    }
+
+    SFrameBSInfo info;
+    std::memset(&info, 0, sizeof(info));
+    if(int e = Impl->Encoder->EncodeFrame(&pic, &info); e != cmResultSuccess)
+        throw ErrorCode(e);
+
+    st.Skipped = info.eFrameType == videoFrameTypeSkip;
+    st.Keyframe = info.eFrameType == videoFrameTypeIDR;
+
+    if(!st.Skipped)
+    {
+        for(int l = 0; l < info.iLayerNum; ++l)
+        {
+            const SLayerBSInfo &layer = info.sLayerInfo[l];
+            size_t bytes = 0;
+            for(int n = 0; n < layer.iNalCount; ++n)
+                bytes += layer.pNalLengthInByte[n];
+
+            Impl->Sink->writeSink(reinterpret_cast<const char*>(layer.pBsBuf), bytes);
+            st.Bytes += bytes;
+            Codecstats::add(Impl->Stats.Units, layer.iNalCount);
+        }
+    }
+
+    auto end = Clock::now();
+    st.Encodetime = end - converted;
+    Impl->Last = st;
+
+    Impl->Stats.addDecodetime(end - begin);
+    Codecstats::add(st.Skipped ? Impl->Stats.Skipped : Impl->Stats.Frames);
+    Codecstats::add(Impl->Stats.BytesConsumed, frameBytes(frame.Format, frame.Width, frame.Height));
+    Codecstats::add(Impl->Stats.BytesProduced, st.Bytes);
+}
+
+const Codecstats *Encoder::codecStats() const
+{
+    return &Impl->Stats;
+}
+
+void Encoder::forceKeyframe()
+{
+    Impl->Forcekey = true;
+}
+
+Encoder::Framestats Encoder::lastFrame() const
+{
+    return Impl->Last;
+}
+
+}
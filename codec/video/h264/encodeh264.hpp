@@ -0,0 +1,74 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <chrono>
+#include <cstdint>
+#include <mlib/stream/sinkinterface.hpp>
+
+#include "../codec.hpp"
+#include "common264.hpp"
+
+namespace mlib::codec::video::h264
+{
+
+//
+// H264 encoder
+//
+// Encodes frames with openh264 and writes them to a sink as AnnexB stream, each frame's
+// NAL units before encodeFrame returns. Frames in formats other than YUV12P are converted
+// first (see Pxconv). The encoder is set up on the first frame and again when the frame size
+// or a parameter changes, starting with an IDR frame.
+// - forceKeyframe makes the next frame an IDR frame.
+// - lastFrame returns statistics of the most recent encodeFrame.
+//
+
+//
+// parameters
+//
+// - bitrate: target bits per second, default: 8000000
+// - framerate: frames per second, default: 60
+// - keyinterval: frames between IDR frames, 0 for only the first, default: 120
+// - threads: encoding threads, each encoding a slice of every frame, default: 0 for hardware threads
+//   At most 4, openh264's limit, and at most one per row of macroblocks.
+// - convthreads: threads converting frames to YUV12P, see Pxconv, default: 1
+// - ratecontrol: lowlatency (default), bitrate, quality or off
+//   lowlatency caps the bitrate and skips frames rather than letting the output lag behind,
+//   using one reference frame and the encoder's lowest complexity.
+//
+
+class Encoder : public IVideoEncodec
+{
+public:
+    struct Framestats
+    {
+        uint64_t Frame = 0;         //number of the frame since construction
+        size_t Bytes = 0;           //bytes written, 0 if skipped
+        bool Keyframe = false, Skipped = false;
+        std::chrono::nanoseconds Converttime{ 0 }, Encodetime{ 0 };
+    };
+
+    Encoder(mlib::stream::ISink &sink, std::vector<std::pair<std::string, std::string>> parameters = {});
+    ~Encoder();
+
+    void codecLogging(CodecLoglevel, CodecLogger) override;
+    void codecParameter(const std::string &parameter, const std::string &value) override;
+
+    void encodeFrame(const Videoframe&) override;
+
+    const Codecstats *codecStats() const override;
+
+    void forceKeyframe();
+    Framestats lastFrame() const;
+
+    Encoder(Encoder&&) = delete;
+    Encoder(const Encoder&) = delete;
+    Encoder &operator=(Encoder&&) = delete;
+    Encoder &operator=(const Encoder&) = delete;
+
+private:
+    struct ImplData;
+    std::unique_ptr<ImplData> Impl;
+};
+
+}
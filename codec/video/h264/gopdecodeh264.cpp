@@ -0,0 +1,356 @@
+#include "gopdecodeh264.hpp"
+#include "implh264.hpp"
+#include "../source/memorysource.hpp"
+
+#include <utility>
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+
+namespace mlib::codec::video::h264
+{
+
+static void appendUnit(std::vector<unsigned char> &v, const unsigned char *unit, size_t len)
+{
+    v.insert(v.end(), unit, unit + len);
+}
+
+//
+// GOP decoder
+//
+
+GopDecoder::GopDecoder(ICodecSourcebuffer &source, std::vector<std::pair<std::string, std::string>> parameters)
+    : Counted(source, Stats), Reader(1024 * 1024), BuildingVCL(false), SourceEnded(false), FrameIndex(0), Skipgroup(false), Threads(0), MaxInflight(0), MaxFrames(240), Loglevel(CodecLoglevel::None)
+{
+    for(const auto &[p, v] : parameters)
+        setParameter(p, v);
+
+    Buffers = std::make_shared<Framepool>();
+    Pool = std::make_unique<Workerpool>(Threads);
+
+    Reader.attach(Counted);
+}
+
+GopDecoder::~GopDecoder()
+{
+    drain();
+}
+
+void GopDecoder::setParameter(const std::string &p, const std::string &v)
+{
+    size_t n;
+    if(sscanf(v.c_str(), "%zu", &n) != 1)
+        throw GenericError<WrongParameter>(p);
+
+    if(p == "bufcapacity")
+    {
+        if(n <= 4)
+            throw GenericError<WrongParameter>(p);
+        Reader.BufferCapacity = n;
+    }
+    else if(p == "threads")
+        Threads = n;
+    else if(p == "inflight")
+    {
+        if(n == 0)
+            throw GenericError<WrongParameter>(p);
+        MaxInflight = n;
+    }
+    else if(p == "maxframes")
+    {
+        if(n == 0)
+            throw GenericError<WrongParameter>(p);
+        MaxFrames = n;
+    }
+    else
+        throw GenericError<UnknownParameter>(p);
+}
+
+void GopDecoder::codecFramepool(std::shared_ptr<Framepool> p)
+{
+    Buffers = p ? std::move(p) : std::make_shared<Framepool>();
+}
+
+const Codecstats *GopDecoder::codecStats() const
+{
+    return &Stats;
+}
+
+bool GopDecoder::codecSkip(Frameskip mode)
+{
+    if(mode == Frameskip::Nonreference)
+        return false;
+
+    Skipgroup = mode == Frameskip::Keyframe;
+    return true;
+}
+
+void GopDecoder::codecLogging(CodecLoglevel l, CodecLogger h)
+{
+    drain();
+
+    Loglevel = l;
+    Logger = std::move(h);
+    for(auto &[d, s] : Decoders)
+        d->logging(Loglevel, Logger);
+}
+
+void GopDecoder::codecParameter(const std::string &parameter, const std::string &value)
+{
+    auto pos = tellFrame();
+    drain();
+
+    auto oldthreads = Threads;
+    setParameter(parameter, value);
+
+    if(parameter == "threads" && Threads != oldthreads)
+        Pool = std::make_unique<Workerpool>(Threads);
+
+    seekFrame(*pos);
+}
+
+//groups begin with an IDR picture, so a decoder continues with the next group unless the parameter sets change
+std::unique_ptr<Decoder::ImplData> GopDecoder::acquireDecoder(const Parametersets &sets)
+{
+    {
+        std::lock_guard<std::mutex> l(DecodersLock);
+        if(!Decoders.empty())
+        {
+            auto it = std::find_if(Decoders.begin(), Decoders.end(), [&sets](const auto &d) { return d.second == sets; });
+            bool same = it != Decoders.end();
+            if(!same)
+                it = Decoders.end() - 1;
+
+            auto d = std::move(it->first);
+            Decoders.erase(it);
+            if(!same)
+                d->reset();
+            return d;
+        }
+    }
+
+    auto d = std::make_unique<Decoder::ImplData>(Reader.BufferCapacity);
+    d->logging(Loglevel, Logger);
+    return d;
+}
+
+void GopDecoder::releaseDecoder(std::unique_ptr<Decoder::ImplData> d, const Parametersets &sets)
+{
+    std::lock_guard<std::mutex> l(DecodersLock);
+    Decoders.emplace_back(std::move(d), sets);
+}
+
+void GopDecoder::decode(Gop &g, Framepool &buffers)
+{
+    try
+    {
+        auto d = acquireDecoder(g.Sets);
+
+        memorysource::MemorySource src(g.Bytes.data(), g.Bytes.size());
+        d->Reader.attach(src);
+
+        Videoframe f;
+        while(d->fetchFrame(f))
+            g.Frames.push_back(copyFrame(f, buffers));
+        while(d->flushFrame(f))
+            g.Frames.push_back(copyFrame(f, buffers));
+
+        Codecstats::add(Stats.Units, d->Stats.Units.load(std::memory_order_relaxed));
+        Codecstats::add(Stats.BytesConsumed, d->Stats.BytesConsumed.load(std::memory_order_relaxed));
+        Codecstats::add(Stats.Dropped, d->Stats.Dropped.load(std::memory_order_relaxed));
+        d->Stats.reset();
+
+        releaseDecoder(std::move(d), g.Sets);
+    }
+    catch(...)
+    {
+        g.Error = std::current_exception();
+    }
+}
+
+std::unique_ptr<GopDecoder::Gop> GopDecoder::readGop()
+{
+    for(;;)
+    {
+        std::shared_ptr<const Nalreader::Seekinfo> pos = Reader.tell();
+        const auto[success, start, len] = Reader.nextUnit();
+
+        if(!success)
+        {
+            SourceEnded = true;
+            if(Building)
+                appendUnit(Building->Bytes, Prefix.data(), Prefix.size());
+            Prefix.clear();
+
+            return std::move(Building);
+        }
+
+        const unsigned char *unit = Reader.unitData(start);
+        auto type = nalType(unit, len);
+
+        if(type != Nalunit::Slice && type != Nalunit::IDR) //non-VCL units belong to the following picture
+        {
+            if(Prefix.empty())
+                PrefixPosition = pos;
+            appendUnit(Prefix, unit, len);
+
+            if(type == Nalunit::SPS || type == Nalunit::PPS)
+                Sets[{ type, nalParameterId(unit, len) }].assign(unit, unit + len);
+
+            continue;
+        }
+
+        bool picturestart = nalPicturestart(unit, len);
+
+        std::unique_ptr<Gop> done;
+        if(type == Nalunit::IDR && BuildingVCL && picturestart) //further slices of an IDR picture stay in its group
+            done = std::move(Building);
+
+        if(!Building)
+        {
+            Building = std::make_unique<Gop>();
+            Building->Position = Prefix.empty() ? pos : PrefixPosition;
+            Building->Sets = Sets;
+            for(const auto &[k, s] : Sets)
+                appendUnit(Building->Bytes, s.data(), s.size());
+            BuildingVCL = false;
+        }
+
+        appendUnit(Building->Bytes, Prefix.data(), Prefix.size());
+        Prefix.clear();
+        appendUnit(Building->Bytes, unit, len);
+        BuildingVCL = true;
+        if(picturestart)
+            ++Building->Pictures;
+
+        if(done)
+            return done;
+    }
+}
+
+void GopDecoder::fill()
+{
+    size_t maxinflight = MaxInflight ? MaxInflight : Pool->size() * 2;
+
+    size_t pictures = 0;
+    for(const auto &g : Inflight)
+        pictures += g->Pictures;
+
+    while(!SourceEnded && Inflight.size() < maxinflight && pictures < MaxFrames)
+    {
+        auto g = readGop();
+        if(!g)
+            break;
+
+        pictures += g->Pictures;
+        Gop *gp = g.get();
+        g->Done = Pool->post([this, gp, buffers = Buffers]() { decode(*gp, *buffers); });
+        Inflight.push_back(std::move(g));
+    }
+}
+
+void GopDecoder::drain()
+{
+    for(auto &g : Inflight)
+        g->Done.wait();
+}
+
+bool GopDecoder::fetchFrame(Videoframe &f)
+{
+    auto begin = std::chrono::steady_clock::now();
+    for(;;)
+    {
+        fill();
+
+        if(Inflight.empty())
+            return false;
+
+        auto &g = *Inflight.front();
+        g.Done.wait();
+
+        if(Skipgroup && FrameIndex == 0 && !g.Frames.empty()) //a group begins with a keyframe
+            Skipgroup = false;
+
+        if(Skipgroup && FrameIndex < g.Frames.size())
+        {
+            Codecstats::add(Stats.Skipped, g.Frames.size() - FrameIndex);
+            FrameIndex = g.Frames.size();
+        }
+
+        if(FrameIndex < g.Frames.size())
+        {
+            f = g.Frames[FrameIndex++];
+            Stats.addDecodetime(std::chrono::steady_clock::now() - begin);
+            Codecstats::add(Stats.Frames);
+            return true;
+        }
+
+        auto error = g.Error;
+        FrameIndex -= std::min(FrameIndex, g.Frames.size()); //frames to skip after seeking might span groups
+        Inflight.pop_front();
+
+        if(error)
+            std::rethrow_exception(error);
+    }
+}
+
+//
+// seeking
+//
+
+struct GopSeek : public ISourceSeek
+{
+    std::shared_ptr<const Nalreader::Seekinfo> Position;
+    std::map<std::pair<Nalunit, unsigned int>, std::vector<unsigned char>> Sets;
+    size_t Frame;
+};
+
+std::unique_ptr<ISourceSeek> GopDecoder::tellFrame() const
+{
+    auto s = std::make_unique<GopSeek>();
+    s->Frame = FrameIndex;
+
+    size_t idx = 0;
+    if(!Inflight.empty() && FrameIndex > 0 && FrameIndex >= Inflight.front()->Frames.size()) //current group consumed
+    {
+        idx = 1;
+        s->Frame = FrameIndex - Inflight.front()->Frames.size();
+    }
+
+    if(idx < Inflight.size())
+    {
+        s->Position = Inflight[idx]->Position;
+        s->Sets = Inflight[idx]->Sets;
+    }
+    else if(Building)
+    {
+        s->Position = Building->Position;
+        s->Sets = Building->Sets;
+    }
+    else
+    {
+        s->Position = Prefix.empty() ? std::shared_ptr<const Nalreader::Seekinfo>(Reader.tell()) : PrefixPosition;
+        s->Sets = Sets;
+    }
+
+    return s;
+}
+
+void GopDecoder::seekFrame(const ISourceSeek &sk)
+{
+    const auto &s = static_cast<const GopSeek&>(sk);
+
+    drain();
+    Inflight.clear();
+    Building.reset();
+    BuildingVCL = false;
+    Skipgroup = false;
+    Prefix.clear();
+
+    Reader.seek(*s.Position);
+    Sets = s.Sets;
+    SourceEnded = false;
+    FrameIndex = s.Frame;
+}
+
+}
@@ -0,0 +1,123 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <deque>
+#include <map>
+#include <mutex>
+#include <future>
+#include <exception>
+#include <memory>
+
+#include "../codec.hpp"
+#include "../workerpool.hpp"
+#include "../framepool.hpp"
+#include "../codecstats.hpp"
+#include "decodeh264.hpp"
+#include "nalreader.hpp"
+
+namespace mlib::codec::video::h264
+{
+
+//
+// GOP-parallel H264 decoder
+//
+// Decodes H264 stream in AnnexB format by splitting it at IDR pictures into groups of pictures,
+// which are decoded on a pool of worker threads, each group by its own decoder instance.
+// Frames are returned in the same order as by Decoder.
+// The most recent parameter sets are prepended to every group, so groups decode independently.
+// Decoded frames are kept in buffers of an internal pool unless another pool is set, so
+// they are always owned (see Videoframe::Owner).
+// The logger is called from the worker threads.
+// codecStats counts the source's reads and, as groups are decoded, their NAL units, bytes and units
+// openh264 failed to decode as dropped. Parameter sets count once per group they are prepended to.
+// Decode times are those of fetchFrame, including waiting for a group's decoding.
+// codecSkip supports Keyframe only, skipping the rest of the current group, which is counted as
+// skipped though it may have been decoded already.
+// A group's bytes and frames are held until its last frame is fetched. Further groups are started
+// while fewer than maxframes pictures are held, so at most maxframes plus one group's frames are.
+// Pooled decoder instances are only reinitialized for a group with different parameter sets.
+//
+
+//
+// parameters
+//
+// - bufcapacity: the internal's buffer size, default: 1MiB
+// - threads: number of worker threads, default: number of hardware threads
+// - inflight: maximum number of groups decoded ahead, default: twice the number of threads
+// - maxframes: number of pictures held before no further groups are started, default: 240
+//
+
+class GopDecoder : public IVideoDecodec
+{
+public:
+    GopDecoder(ICodecSourcebuffer &source, std::vector<std::pair<std::string, std::string>> parameters = {});
+    ~GopDecoder();
+
+    void codecLogging(CodecLoglevel, CodecLogger) override;
+    void codecParameter(const std::string &parameter, const std::string &value) override;
+
+    bool fetchFrame(Videoframe&) override;
+
+    std::unique_ptr<ISourceSeek> tellFrame() const override;
+    void seekFrame(const ISourceSeek&) override;
+
+    void codecFramepool(std::shared_ptr<Framepool>) override;
+    const Codecstats *codecStats() const override;
+    bool codecSkip(Frameskip mode) override;
+
+    GopDecoder(GopDecoder&&) = delete;
+    GopDecoder(const GopDecoder&) = delete;
+    GopDecoder &operator=(GopDecoder&&) = delete;
+    GopDecoder &operator=(const GopDecoder&) = delete;
+
+private:
+    using Parametersets = std::map<std::pair<Nalunit, unsigned int>, std::vector<unsigned char>>;
+
+    struct Gop
+    {
+        std::shared_ptr<const Nalreader::Seekinfo> Position;
+        Parametersets Sets;
+        std::vector<unsigned char> Bytes;
+        size_t Pictures = 0;
+        std::vector<Videoframe> Frames;
+        std::exception_ptr Error;
+        std::future<void> Done;
+    };
+
+    void setParameter(const std::string &parameter, const std::string &value);
+
+    std::unique_ptr<Gop> readGop();
+    void fill();
+    void drain();
+    void decode(Gop &g, Framepool &buffers);
+
+    std::unique_ptr<Decoder::ImplData> acquireDecoder(const Parametersets &sets);
+    void releaseDecoder(std::unique_ptr<Decoder::ImplData> d, const Parametersets &sets);
+
+    Codecstats Stats;
+    Statsource Counted;
+    Nalreader Reader;
+    Parametersets Sets;
+    std::unique_ptr<Gop> Building;
+    bool BuildingVCL;
+    std::vector<unsigned char> Prefix;
+    std::shared_ptr<const Nalreader::Seekinfo> PrefixPosition;
+    bool SourceEnded;
+
+    std::deque<std::unique_ptr<Gop>> Inflight;
+    size_t FrameIndex;
+    bool Skipgroup;
+    size_t Threads, MaxInflight, MaxFrames; //MaxInflight 0: twice the pool's threads
+
+    std::mutex DecodersLock;
+    std::vector<std::pair<std::unique_ptr<Decoder::ImplData>, Parametersets>> Decoders; //with the sets last decoded
+    CodecLoglevel Loglevel;
+    CodecLogger Logger;
+
+    std::shared_ptr<Framepool> Buffers;
+
+    std::unique_ptr<Workerpool> Pool;
+};
+
+}
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <wels/codec_api.h>
+#include <wels/codec_def.h>
+
+#include "decodeh264.hpp"
+#include "nalreader.hpp"
+#include "../codecstats.hpp"
+
+namespace mlib::codec::video::h264
+{
+
+//
+// decoder implementation
+//
+// Shared by the decoders of this directory, not part of the public interface.
+// - reset reinitializes the openh264 decoder so the instance can be reused for another stream.
+// - logging installs the logger, which is kept across reset.
+// - fetchFrame decodes NAL units from the reader until a frame is complete.
+// - flushFrame retrieves frames still buffered by openh264 at the end of a stream.
+// - Stats counts the units decoded, Counted wraps the source of a Decoder to count its reads.
+//   Failed keeps a picture with several undecodable slices from being counted as dropped again.
+// - skipUnit returns whether a unit is skipped in the Skip mode, leaving it when reaching a keyframe.
+//   With Keyonly, all units but parameter sets and IDR slices are skipped.
+//
+
+struct Decoder::ImplData
+{
+    CodecLoglevel Loglevel;
+    CodecLogger Logger;
+    Nalreader Reader;
+    ISVCDecoder *Decoder;
+    std::shared_ptr<Framepool> Buffers;
+    Codecstats Stats;
+    std::unique_ptr<Statsource> Counted;
+    Frameskip Skip = Frameskip::None;
+    bool Keyonly = false;
+    bool Failed = false; //a slice of the current picture failed to decode
+
+    ImplData(size_t capacity);
+    ~ImplData();
+
+    void reset();
+    void logging(CodecLoglevel l, CodecLogger h);
+
+    static void tracecb(void *ctx, int level, const char *msg);
+
+    bool fetchFrame(Videoframe &f);
+    bool skipUnit(const unsigned char *unit, size_t len, Nalunit type);
+    bool flushFrame(Videoframe &f);
+
+    static void fillFrame(Videoframe &f, const SBufferInfo &bufinfo, unsigned char *const *picptrs);
+};
+
+}
@@ -0,0 +1,141 @@
+#include "indexh264.hpp"
+
+#include <istream>
+#include <ostream>
+#include <algorithm>
+
+namespace mlib::codec::video::h264
+{
+
+//
+// varint
+//
+
+static void writeVarint(std::ostream &o, uint64_t v)
+{
+    do
+    {
+        unsigned char b = v & 0x7F;
+        v >>= 7;
+        o.put(static_cast<char>(v ? b | 0x80 : b));
+    } while(v);
+}
+
+static uint64_t readVarint(std::istream &i)
+{
+    uint64_t v = 0;
+    for(unsigned int shift = 0; shift < 64; shift += 7)
+    {
+        int c = i.get();
+        if(c == std::char_traits<char>::eof())
+            throw GenericError<StreamUnexpectedEnd>("index");
+
+        v |= static_cast<uint64_t>(c & 0x7F) << shift;
+        if(!(c & 0x80))
+            return v;
+    }
+
+    throw GenericError<StreamMalformed>("index varint");
+}
+
+//
+// index
+//
+
+Index Index::build(ICodecSourcebuffer &source, size_t capacity)
+{
+    Index idx;
+
+    Nalreader reader(capacity);
+    reader.attach(source);
+
+    for(;;)
+    {
+        const auto[success, start, len] = reader.nextUnit();
+        if(!success)
+            break;
+
+        const unsigned char *unit = reader.unitData(start);
+        auto type = nalType(unit, len);
+        uint64_t offset = source.sourceOffset() + start;
+
+        bool newpicture = (type == Nalunit::Slice || type == Nalunit::IDR) && nalPicturestart(unit, len);
+
+        if(type == Nalunit::SPS || type == Nalunit::PPS)
+            idx.Entries.push_back({ type, offset, idx.Frames, nalParameterId(unit, len) });
+        else if(type == Nalunit::IDR && newpicture)
+            idx.Entries.push_back({ type, offset, idx.Frames });
+
+        if(newpicture)
+            ++idx.Frames;
+    }
+
+    return idx;
+}
+
+void Index::save(std::ostream &o) const
+{
+    o.write("HIX!\x02", 5);
+    writeVarint(o, Frames);
+    writeVarint(o, Entries.size());
+
+    uint64_t offset = 0, frame = 0;
+    for(const auto &e : Entries)
+    {
+        o.put(static_cast<char>(e.Type));
+        writeVarint(o, e.Offset - offset);
+        writeVarint(o, e.Frame - frame);
+        if(e.Type == Nalunit::SPS || e.Type == Nalunit::PPS)
+            writeVarint(o, e.Id);
+        offset = e.Offset;
+        frame = e.Frame;
+    }
+
+    if(!o)
+        throw GenericError<CodecError>("index write");
+}
+
+Index Index::load(std::istream &i)
+{
+    char sig[5];
+    if(!i.read(sig, 5))
+        throw GenericError<StreamUnexpectedEnd>("index header");
+    if(sig[0] != 'H' || sig[1] != 'I' || sig[2] != 'X' || sig[3] != '!' || sig[4] != 2)
+        throw GenericError<StreamMalformed>("invalid index signature");
+
+    Index idx;
+    idx.Frames = readVarint(i);
+    auto n = readVarint(i);
+
+    uint64_t offset = 0, frame = 0;
+    for(uint64_t k = 0; k < n; ++k)
+    {
+        int type = i.get();
+        if(type == std::char_traits<char>::eof())
+            throw GenericError<StreamUnexpectedEnd>("index");
+
+        offset += readVarint(i);
+        frame += readVarint(i);
+        idx.Entries.push_back({ static_cast<Nalunit>(type), offset, frame });
+        if(idx.Entries.back().Type == Nalunit::SPS || idx.Entries.back().Type == Nalunit::PPS)
+            idx.Entries.back().Id = static_cast<unsigned int>(readVarint(i));
+    }
+
+    return idx;
+}
+
+const Index::Entry *Index::keyframe(uint64_t frame) const
+{
+    auto it = std::upper_bound(Entries.begin(), Entries.end(), frame, [](uint64_t f, const Entry &e) { return f < e.Frame; });
+
+    while(it != Entries.begin())
+    {
+        --it;
+        if(it->Type == Nalunit::IDR)
+            return &*it;
+    }
+
+    return nullptr;
+}
+
+}
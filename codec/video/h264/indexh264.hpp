@@ -0,0 +1,64 @@
+#pragma once
+
+#include <vector>
+#include <iosfwd>
+#include <cstdint>
+
+#include "../codec.hpp"
+#include "common264.hpp"
+#include "nalreader.hpp"
+
+namespace mlib::codec::video::h264
+{
+
+//
+// keyframe index
+//
+// Records stream offset and frame number of each SPS, PPS and IDR unit of an AnnexB stream,
+// and the parameter set id of SPS and PPS units.
+// The frame number of a unit is the number of pictures preceding it.
+// - build scans a source once from its current position to its end.
+//   The source must support sourceOffset.
+// - save/load store the index in a compact sidecar format.
+// - keyframe returns the last IDR entry at or before a frame, or nullptr.
+//
+// sidecar format: (little endian, varint: LEB128)
+// 'HIX!' signature
+// [uint8] version (currently 0x02)
+// [varint] number of frames
+// [varint] number of entries
+//
+// for all entries:
+// [uint8] NAL unit type
+// [varint] offset delta to previous entry
+// [varint] frame delta to previous entry
+// [varint] parameter set id, SPS and PPS only
+//
+
+class Index
+{
+public:
+    struct Entry
+    {
+        Nalunit Type;
+        uint64_t Offset;
+        uint64_t Frame;
+        unsigned int Id = 0; //seq_parameter_set_id or pic_parameter_set_id
+    };
+
+    static Index build(ICodecSourcebuffer &source, size_t capacity = 1024 * 1024);
+
+    void save(std::ostream &o) const;
+    static Index load(std::istream &i);
+
+    const std::vector<Entry> &entries() const { return Entries; }
+    uint64_t frameCount() const { return Frames; }
+
+    const Entry *keyframe(uint64_t frame) const;
+
+private:
+    std::vector<Entry> Entries;
+    uint64_t Frames = 0;
+};
+
+}
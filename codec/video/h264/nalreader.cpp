@@ -0,0 +1,183 @@
+#include "nalreader.hpp"
+#include "common264.hpp"
+#include "startcode.hpp"
+
+#include <utility>
+
+namespace mlib::codec::video::h264
+{
+
+Nalunit nalType(const unsigned char *unit, size_t len)
+{
+    size_t i = 0;
+    while(i < len && unit[i] == 0) //skip start code
+        ++i;
+
+    if(i + 1 >= len)
+        return static_cast<Nalunit>(0);
+
+    return static_cast<Nalunit>(unit[i + 1] & 0x1F);
+}
+
+bool nalReference(const unsigned char *unit, size_t len)
+{
+    size_t i = 0;
+    while(i < len && unit[i] == 0)
+        ++i;
+
+    return i + 1 < len && (unit[i + 1] & 0x60) != 0;
+}
+
+bool nalPicturestart(const unsigned char *unit, size_t len)
+{
+    size_t i = 0;
+    while(i < len && unit[i] == 0)
+        ++i;
+
+    return i + 2 < len && (unit[i + 2] & 0x80) != 0; //ue(v) coded 0 is a single 1 bit
+}
+
+unsigned int nalParameterId(const unsigned char *unit, size_t len)
+{
+    size_t i = 0;
+    while(i < len && unit[i] == 0) //skip start code
+        ++i;
+
+    const unsigned char *payload = unit + i + 2; //skip start code's 01 and unit header
+    size_t nbits = i + 2 < len ? (len - i - 2) * 8 : 0;
+    size_t bit = nalType(unit, len) == Nalunit::SPS ? 24 : 0; //skip profile, constraint flags and level of SPS
+
+    auto readbit = [&]() -> unsigned int
+    {
+        if(bit >= nbits)
+            throw GenericError<StreamMalformed>("parameter set too short");
+        unsigned int b = payload[bit / 8] >> (7 - bit % 8) & 1;
+        ++bit;
+        return b;
+    };
+
+    unsigned int zeros = 0; //exp-golomb code
+    while(readbit() == 0)
+    {
+        if(++zeros > 31)
+            throw GenericError<StreamMalformed>("invalid parameter set id");
+    }
+
+    unsigned int value = 0;
+    for(unsigned int z = 0; z < zeros; ++z)
+        value = value << 1 | readbit();
+
+    return (1u << zeros) - 1 + value;
+}
+
+void Nalreader::attach(ICodecSourcebuffer &source)
+{
+    Source = &source;
+
+    size_t curlen;
+    std::tie(std::ignore, curlen) = Source->bufferProperties();
+
+    if(curlen < BufferCapacity)
+        Source->extendBuffer(BufferCapacity - curlen);
+
+    std::tie(SourcebufferBegin, SourcebufferLength) = Source->bufferProperties();
+    CurrentOffset = 0;
+}
+
+std::tuple<bool, size_t, size_t> Nalreader::nextUnit()
+{
+    auto r = nextNALUnit(CurrentOffset);
+    if(std::get<0>(r)) //stay at the end, the buffer still holds the last unit
+        CurrentOffset = std::get<1>(r) + std::get<2>(r);
+    return r;
+}
+
+size_t Nalreader::findBoundary(size_t off, size_t unitbegin) const
+{
+    auto buf = static_cast<const unsigned char*>(SourcebufferBegin);
+
+    size_t pos = findStartcode(buf, off, SourcebufferLength);
+    if(pos == SourcebufferLength)
+        return SourcebufferLength;
+
+    if(pos > unitbegin && buf[pos - 1] == 0) //4-byte start code: 00 00 00 01
+        --pos;
+
+    return pos;
+}
+
+std::tuple<bool, size_t, size_t> Nalreader::nextNALUnit(size_t off)
+{
+    if(SourcebufferLength < 3 || off >= SourcebufferLength)
+        return { false, 0, 0 };
+
+    auto buf = static_cast<const unsigned char*>(SourcebufferBegin);
+
+    size_t startoff = off; //begin at position where we stopped last time
+    while(off < SourcebufferLength && buf[off] == 0) //jump over start bytes of current NAL unit
+        ++off;
+    ++off;
+
+    if(size_t end = findBoundary(off, off); end < SourcebufferLength) //search start code of next unit until end of buffer
+        return { true, startoff, end - startoff }; //return success, start offset into buffer, length of found unit
+
+    auto advance = startoff; //start code not found -> pull more bytes
+    size_t nread;
+    std::tie(SourcebufferBegin, nread) = Source->advanceBuffer(advance);
+
+    SourcebufferLength -= (advance - nread); //less data might have been read
+
+    off -= advance; //adjust offset to where the unit's payload begins
+    size_t payloadoff = off;
+
+    for(;;)
+    {
+        if(size_t end = findBoundary(off, payloadoff); end < SourcebufferLength)
+            return { true, 0, end }; //return success, start offset into buffer, length of found unit
+
+        if(SourcebufferLength > off + 2) //continue where we stopped, a start code might span the buffer's end
+            off = SourcebufferLength - 2;
+
+        //not found: unit might be longer than buffer -> extend buffer
+        std::tie(SourcebufferBegin, nread) = Source->extendBuffer(BufferCapacity);
+        SourcebufferLength += nread;
+
+        if(nread == 0) //no new data has been appended -> stream is empty, return last unit
+            return { true, 0, SourcebufferLength };
+    }
+}
+
+std::unique_ptr<Nalreader::Seekinfo> Nalreader::tell() const
+{
+    auto inf = std::make_unique<Seekinfo>();
+    inf->BufferSeekinfo = Source->sourceTell();
+    inf->BufferOffset = CurrentOffset;
+    inf->BufferSize = SourcebufferLength;
+    return inf;
+}
+
+void Nalreader::seek(const Seekinfo &inf)
+{
+    Source->sourceSeek(*inf.BufferSeekinfo);
+
+    if(auto siz = Source->bufferProperties().second; siz < inf.BufferSize)
+        Source->extendBuffer(inf.BufferSize - siz);
+
+    std::tie(SourcebufferBegin, SourcebufferLength) = Source->bufferProperties();
+
+    if(SourcebufferLength != inf.BufferSize)
+    {
+        SourcebufferLength = 0;
+        throw StreamUnexpectedEnd("seek frame");
+    }
+
+    CurrentOffset = inf.BufferOffset;
+}
+
+void Nalreader::seekOffset(uint64_t offset)
+{
+    Source->sourceSeekOffset(offset);
+    attach(*Source);
+}
+
+}
\ No newline at end of file
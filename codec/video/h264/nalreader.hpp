@@ -0,0 +1,83 @@
+#pragma once
+
+#include <tuple>
+#include <memory>
+
+#include "../codec.hpp"
+
+namespace mlib::codec::video::h264
+{
+
+//
+// NAL unit types
+//
+
+enum class Nalunit : unsigned int
+{
+    Slice = 1,
+    IDR = 5,
+    SEI = 6,
+    SPS = 7,
+    PPS = 8,
+    AUD = 9
+};
+
+//
+// NAL unit header, of units starting with their start code
+//
+// - nalType returns the type of a NAL unit.
+// - nalReference returns whether other units may refer to the unit (nal_ref_idc is not 0).
+// - nalPicturestart returns whether a slice unit is the first of its picture (first_mb_in_slice is 0).
+// - nalParameterId returns seq_parameter_set_id of an SPS or pic_parameter_set_id of a PPS unit.
+//
+
+Nalunit nalType(const unsigned char *unit, size_t len);
+bool nalReference(const unsigned char *unit, size_t len);
+bool nalPicturestart(const unsigned char *unit, size_t len);
+unsigned int nalParameterId(const unsigned char *unit, size_t len);
+
+//
+// NAL unit reader
+//
+// Splits the AnnexB stream of a sourcebuffer into NAL units including their start codes.
+// Both 3-byte (00 00 01) and 4-byte (00 00 00 01) start codes are recognized.
+// - attach binds a source and fills the buffer up to the buffer capacity.
+// - nextUnit returns success, the unit's offset into the buffer and its length.
+//   The buffer may be advanced, so pointers into it are only valid until the next call.
+// - tell/seek save and restore the position of the next unit.
+// - seekOffset moves to a unit beginning at an offset into the stream, see ICodecSourcebuffer::sourceSeekOffset.
+//
+
+struct Nalreader
+{
+    struct Seekinfo : public ISourceSeek
+    {
+        std::unique_ptr<ISourceSeek> BufferSeekinfo;
+        size_t BufferOffset;
+        size_t BufferSize;
+    };
+
+    ICodecSourcebuffer *Source;
+
+    const void *SourcebufferBegin;
+    size_t SourcebufferLength, CurrentOffset;
+
+    size_t BufferCapacity;
+
+    Nalreader(size_t capacity) : Source(nullptr), SourcebufferBegin(nullptr), SourcebufferLength(0), CurrentOffset(0), BufferCapacity(capacity) {}
+
+    void attach(ICodecSourcebuffer &source);
+
+    std::tuple<bool, size_t, size_t> nextUnit();
+    const unsigned char *unitData(size_t start) const { return &static_cast<const unsigned char*>(SourcebufferBegin)[start]; }
+
+    std::unique_ptr<Seekinfo> tell() const;
+    void seek(const Seekinfo &inf);
+    void seekOffset(uint64_t offset);
+
+private:
+    size_t findBoundary(size_t off, size_t unitbegin) const;
+    std::tuple<bool, size_t, size_t> nextNALUnit(size_t off);
+};
+
+}
@@ -0,0 +1,71 @@
+#include "poolh264.hpp"
+#include "implh264.hpp"
+
+#include <mutex>
+#include <utility>
+
+namespace mlib::codec::video::h264
+{
+
+struct Decoderpool::State
+{
+    size_t Maxidle;
+    std::vector<std::unique_ptr<Decoder::ImplData>> Idle;
+    mutable std::mutex Lock;
+
+    void release(std::unique_ptr<Decoder::ImplData> d)
+    {
+        try
+        {
+            d->logging(CodecLoglevel::None, nullptr);
+            d->reset();
+        }
+        catch(...)
+        {
+            return; //a broken instance is not kept
+        }
+
+        d->Counted.reset();
+        d->Buffers.reset();
+        d->Skip = Frameskip::None;
+        d->Keyonly = false;
+        d->Failed = false;
+        d->Stats.reset();
+
+        std::lock_guard<std::mutex> l(Lock);
+        if(Idle.size() < Maxidle)
+            Idle.push_back(std::move(d));
+    }
+};
+
+Decoderpool::Decoderpool(size_t maxidle) : Shared(std::make_shared<State>())
+{
+    Shared->Maxidle = maxidle;
+}
+
+std::unique_ptr<Decoder> Decoderpool::createDecoder(ICodecSourcebuffer &source, const std::vector<std::pair<std::string, std::string>> &parameters)
+{
+    std::unique_ptr<Decoder::ImplData> d;
+    {
+        std::lock_guard<std::mutex> l(Shared->Lock);
+        if(!Shared->Idle.empty())
+        {
+            d = std::move(Shared->Idle.back());
+            Shared->Idle.pop_back();
+        }
+    }
+
+    std::unique_ptr<Decoder> dec(new Decoder(source, parameters, std::move(d)));
+
+    auto state = Shared; //the decoder keeps the pool alive
+    dec->Recycle = [state](std::unique_ptr<Decoder::ImplData> d) { state->release(std::move(d)); };
+    return dec;
+}
+
+size_t Decoderpool::idleDecoders() const
+{
+    std::lock_guard<std::mutex> l(Shared->Lock);
+    return Shared->Idle.size();
+}
+
+}
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <memory>
+
+#include "decodeh264.hpp"
+
+namespace mlib::codec::video::h264
+{
+
+//
+// H264 decoder pool
+//
+// Keeps the openh264 instances of destroyed decoders, reset and ready for another stream, so
+// decoders of further streams are created without setting up openh264 again.
+// At most maxidle instances are kept. Thread-safe, decoders may outlive the pool.
+// - createDecoder returns a decoder like Decoder's constructor, using an idle instance if there is one.
+//   Loggers and frame pools are not kept across streams.
+// - idleDecoders returns the number of instances kept.
+//
+
+class Decoderpool
+{
+public:
+    Decoderpool(size_t maxidle = 8);
+
+    std::unique_ptr<Decoder> createDecoder(ICodecSourcebuffer &source, const std::vector<std::pair<std::string, std::string>> &parameters = {});
+    size_t idleDecoders() const;
+
+private:
+    struct State;
+    std::shared_ptr<State> Shared;
+};
+
+}
@@ -0,0 +1,27 @@
+#include "seekh264.hpp"
+
+#include <string>
+
+namespace mlib::codec::video::h264
+{
+
+Indexseeker::Indexseeker(Decoder &source, const Index &index)
+    : Source(&source), Keys(&index)
+{
+}
+
+size_t Indexseeker::keyframe(size_t idx) const
+{
+    const Index::Entry *idr = Keys->keyframe(idx);
+    if(!idr)
+        throw GenericError<WrongParameter>("no IDR unit before frame " + std::to_string(idx));
+
+    return static_cast<size_t>(idr->Frame);
+}
+
+void Indexseeker::seek(size_t key)
+{
+    Source->seekToFrame(*Keys, key);
+}
+
+}
@@ -0,0 +1,31 @@
+#pragma once
+
+#include "../cachedframeseq.hpp"
+#include "decodeh264.hpp"
+#include "indexh264.hpp"
+
+namespace mlib::codec::video::h264
+{
+
+//
+// index re-decode points
+//
+// Restarts an H264 decoder at the IDR unit preceding a frame with seekToFrame, using an index
+// built from the same stream. Decoder and index must stay valid; no positions are kept while loading.
+//
+
+class Indexseeker : public IFrameseeker
+{
+public:
+    Indexseeker(Decoder &source, const Index &index);
+
+    void mark(size_t) override {}
+    size_t keyframe(size_t idx) const override;
+    void seek(size_t key) override;
+
+private:
+    Decoder *Source;
+    const Index *Keys;
+};
+
+}
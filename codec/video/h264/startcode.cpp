@@ -0,0 +1,182 @@
+#include "startcode.hpp"
+
+#if defined(__x86_64__) || defined(_M_X64) || (defined(__i386__) && defined(__SSE2__)) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+    #define MLIB_STARTCODE_X86
+    #include <immintrin.h>
+    #ifdef _MSC_VER
+        #include <intrin.h>
+        #define MLIB_TARGET_AVX2
+    #else
+        #define MLIB_TARGET_AVX2 __attribute__((target("avx2")))
+    #endif
+#endif
+
+namespace mlib::codec::video::h264
+{
+
+//
+// scalar
+// Looks at the third byte of each candidate, which skips up to three bytes at a time.
+//
+
+static size_t findScalar(const unsigned char *buf, size_t begin, size_t end)
+{
+    size_t i = begin;
+    while(i + 3 <= end)
+    {
+        auto c = buf[i + 2];
+        if(c > 1)
+            i += 3;
+        else if(c == 0)
+            i += 1;
+        else if(buf[i] == 0 && buf[i + 1] == 0)
+            return i;
+        else
+            i += 3;
+    }
+
+    return end;
+}
+
+#ifdef MLIB_STARTCODE_X86
+
+static unsigned int lowestBit(unsigned int mask)
+{
+#ifdef _MSC_VER
+    unsigned long idx;
+    _BitScanForward(&idx, mask);
+    return idx;
+#else
+    return static_cast<unsigned int>(__builtin_ctz(mask));
+#endif
+}
+
+//
+// SSE2
+// Blocks of 16 candidates without any zero byte are skipped after a single compare.
+//
+
+static size_t findSSE2(const unsigned char *buf, size_t begin, size_t end)
+{
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i one = _mm_set1_epi8(1);
+
+    size_t i = begin;
+    for(; i + 16 + 2 <= end; i += 16)
+    {
+        __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(buf + i));
+        __m128i za = _mm_cmpeq_epi8(a, zero);
+        if(_mm_movemask_epi8(za) == 0)
+            continue;
+
+        __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(buf + i + 1));
+        __m128i c = _mm_loadu_si128(reinterpret_cast<const __m128i*>(buf + i + 2));
+        __m128i m = _mm_and_si128(za, _mm_and_si128(_mm_cmpeq_epi8(b, zero), _mm_cmpeq_epi8(c, one)));
+
+        if(auto mask = static_cast<unsigned int>(_mm_movemask_epi8(m)); mask != 0)
+            return i + lowestBit(mask);
+    }
+
+    return findScalar(buf, i, end);
+}
+
+//
+// AVX2
+//
+
+MLIB_TARGET_AVX2 static size_t findAVX2(const unsigned char *buf, size_t begin, size_t end)
+{
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i one = _mm256_set1_epi8(1);
+
+    size_t i = begin;
+    for(; i + 32 + 2 <= end; i += 32)
+    {
+        __m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(buf + i));
+        __m256i za = _mm256_cmpeq_epi8(a, zero);
+        if(_mm256_movemask_epi8(za) == 0)
+            continue;
+
+        __m256i b = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(buf + i + 1));
+        __m256i c = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(buf + i + 2));
+        __m256i m = _mm256_and_si256(za, _mm256_and_si256(_mm256_cmpeq_epi8(b, zero), _mm256_cmpeq_epi8(c, one)));
+
+        if(auto mask = static_cast<unsigned int>(_mm256_movemask_epi8(m)); mask != 0)
+            return i + lowestBit(mask);
+    }
+
+    return findSSE2(buf, i, end);
+}
+
+static bool hasAVX2()
+{
+#ifdef _MSC_VER
+    int info[4];
+    __cpuid(info, 0);
+    if(info[0] < 7)
+        return false;
+
+    __cpuid(info, 1);
+    bool osxsave = (info[2] & (1 << 27)) != 0;
+    if(!osxsave || (_xgetbv(0) & 0x6) != 0x6) //OS saves ymm registers
+        return false;
+
+    __cpuidex(info, 7, 0);
+    return (info[1] & (1 << 5)) != 0;
+#else
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2");
+#endif
+}
+
+#endif
+
+//
+// dispatch
+//
+
+using Finder = size_t(*)(const unsigned char*, size_t, size_t);
+
+static Finder selectFinder()
+{
+#ifdef MLIB_STARTCODE_X86
+    return hasAVX2() ? findAVX2 : findSSE2;
+#else
+    return findScalar;
+#endif
+}
+
+size_t findStartcode(const unsigned char *buf, size_t begin, size_t end)
+{
+    static const Finder finder = selectFinder();
+    return finder(buf, begin, end);
+}
+
+bool findStartcode(Startcodescan scan, const unsigned char *buf, size_t begin, size_t end, size_t &result)
+{
+    Finder finder = nullptr;
+    switch(scan)
+    {
+    case Startcodescan::Scalar:
+        finder = findScalar;
+        break;
+#ifdef MLIB_STARTCODE_X86
+    case Startcodescan::SSE2:
+        finder = findSSE2;
+        break;
+    case Startcodescan::AVX2:
+        if(hasAVX2())
+            finder = findAVX2;
+        break;
+#endif
+    default:
+        break;
+    }
+
+    if(!finder)
+        return false;
+    result = finder(buf, begin, end);
+    return true;
+}
+
+}
@@ -0,0 +1,27 @@
+#pragma once
+
+#include <cstddef>
+
+namespace mlib::codec::video::h264
+{
+
+//
+// start code scanner
+//
+// Returns the offset of the first 00 00 01 sequence in buf[begin, end) or end if there is none.
+// A 4-byte start code is found by its last three bytes.
+// Uses SSE2/AVX2 if available, which is detected at runtime.
+//
+
+size_t findStartcode(const unsigned char *buf, size_t begin, size_t end);
+
+//
+// Scans with one implementation, to compare them in tests and benchmarks.
+// Returns false and leaves result unchanged if the CPU or build does not support it.
+//
+
+enum class Startcodescan { Scalar, SSE2, AVX2 };
+
+bool findStartcode(Startcodescan scan, const unsigned char *buf, size_t begin, size_t end, size_t &result);
+
+}
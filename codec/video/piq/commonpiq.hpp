@@ -1,10 +1,42 @@
 #pragma once
 
+#include <cstdint>
+
 #include "../codec.hpp"
 
 namespace mlib::codec::video::piq
 {
 
+//
+// container layout
+//
+// Codec tags are little endian four character codes, the frame table entry follows
+// the v2 layout described at Decoder.
+//
+
+constexpr uint32_t fourcc(char a, char b, char c, char d)
+{
+    return (uint32_t)(uint8_t)a | (uint32_t)(uint8_t)b << 8 | (uint32_t)(uint8_t)c << 16 | (uint32_t)(uint8_t)d << 24;
+}
+
+namespace Codectag
+{
+constexpr uint32_t Stbi = fourcc('S', 'T', 'B', 'I'); //image data decodable by stb_image (PNG, JPEG, ...)
+constexpr uint32_t Raw = fourcc('R', 'G', 'B', 'A'); //see payloadpiq.hpp
+constexpr uint32_t Qoi = fourcc('Q', 'O', 'I', 'F');
+constexpr uint32_t Lz4 = fourcc('L', 'Z', '4', 'A');
+}
+
+constexpr size_t Headersize = 9;
+constexpr size_t Entrysize = 16;
+
+struct Frameentry
+{
+    uint64_t Offset; //from the signature
+    uint32_t Size;
+    uint32_t Tag;
+};
+
 //
 // exceptions
 //
@@ -1,22 +1,82 @@
 #include "decodepiq.hpp"
+#include "payloadpiq.hpp"
+#include "imagepiq.hpp"
+#include "../workerpool.hpp"
+#include "../codecstats.hpp"
 
 #include <cassert>
+#include <cstdio>
 #include <utility>
-#include <stb_image.h>
+#include <algorithm>
+#include <deque>
+#include <future>
+#include <chrono>
 
 namespace mlib::codec::video::piq
 {
 
-struct StbDeleter
+struct StreamSeek : public ISourceSeek
 {
-    void operator()(stbi_uc *p) { stbi_image_free(p); }
+    std::shared_ptr<const ISourceSeek> Position;
 };
 
-using StbPixelptr = std::unique_ptr<stbi_uc, StbDeleter>;
+struct FrameSeek : public ISourceSeek
+{
+    size_t Frame;
+};
+
+struct Image
+{
+    std::shared_ptr<unsigned char> Pixels;
+    unsigned int Width = 0, Height = 0;
+};
+
+//frame data located in the source buffer, Shared if it is the data of the previous frame
+struct Decoder::Framedata
+{
+    const void *Data;
+    size_t Size;
+    uint32_t Tag;
+    uint64_t Offset;
+    bool Shared;
+};
+
+//look-ahead decoding of a frame
+struct Job
+{
+    std::vector<char> Data;
+    uint32_t Tag;
+    Image Result;
+};
+
+struct Queued
+{
+    std::shared_ptr<Job> Work;
+    std::shared_future<void> Done;
+    std::shared_ptr<const ISourceSeek> Position;
+    size_t Frame;
+};
 
 struct Decoder::ImplData
 {
-    StbPixelptr Currframe;
+    ImplData(ICodecSourcebuffer &source) : Counted(source, Stats) {}
+
+    Codecstats Stats;
+    Statsource Counted;
+
+    Image Current;
+    bool Owned = false;
+    std::vector<std::shared_ptr<unsigned char>> Batch; //images of the frames of fetchFrames
+
+    int Version = 1;
+    uint64_t Base = 0, Position = 0;
+    std::vector<Frameentry> Table;
+    size_t Next = 0;
+    uint64_t Lastoffset = ~uint64_t(0);
+
+    size_t Lookahead = 0, Threads = 0;
+    std::unique_ptr<Workerpool> Pool;
+    std::deque<Queued> Queue;
 };
 
 static uint32_t read32(const void *ptr)
@@ -25,22 +85,77 @@ static uint32_t read32(const void *ptr)
     return (uint32_t)p[0] | (uint32_t)p[1] << 8 | (uint32_t)p[2] << 16 | (uint32_t)p[3] << 24;
 }
 
-Decoder::Decoder(ICodecSourcebuffer &source, const std::vector<std::pair<std::string, std::string>> &opts) : Source(&source)
+static uint64_t read64(const void *ptr)
 {
-    if(!opts.empty())
-        throw GenericError<UnknownParameter>(opts[0].first);
+    const uint8_t *p = static_cast<const uint8_t*>(ptr);
+    return (uint64_t)read32(p) | (uint64_t)read32(p + 4) << 32;
+}
 
-    auto[ptr, len] = Source->minimalBuffer(8);
-    if(len < 9)
+static Image decodeImage(const void *data, size_t size, uint32_t tag)
+{
+    if(tag != Codectag::Stbi)
+    {
+        Image img;
+        payloadDimensions(data, size, tag, img.Width, img.Height);
+        img.Pixels = allocateImage(img.Width, img.Height);
+        decodePayload(data, size, tag, img.Pixels.get());
+        return img;
+    }
+
+    Image img;
+    img.Pixels = loadImage(data, size, img.Width, img.Height);
+    if(!img.Pixels)
+        throw GenericError<StreamMalformed>("malformed image");
+
+    return img;
+}
+
+Decoder::Decoder(ICodecSourcebuffer &source, const std::vector<std::pair<std::string, std::string>> &opts)
+{
+    Impl = std::make_unique<ImplData>(source);
+    Source = &Impl->Counted;
+
+    auto[ptr, len] = Source->minimalBuffer(Headersize);
+    if(len < Headersize)
         throw GenericError<StreamUnexpectedEnd>("header expected");
 
     const uint8_t *p = static_cast<const uint8_t*>(ptr);
-    if(p[0] != 'P' || p[1] != 'I' || p[2] != 'Q' || p[3] != '!' || p[4] != 1)
+    if(p[0] != 'P' || p[1] != 'I' || p[2] != 'Q' || p[3] != '!' || (p[4] != 1 && p[4] != 2))
         throw GenericError<StreamMalformed>("invalid signature");
 
-    Source->advanceBuffer(9);
+    Impl->Version = p[4];
+    if(Impl->Version == 1)
+        Source->advanceBuffer(Headersize);
+    else
+    {
+        size_t count = read32(p + 5);
+        size_t tablesize = Headersize + count * Entrysize;
+        std::tie(ptr, len) = Source->minimalBuffer(tablesize);
+        if(len < tablesize)
+            throw GenericError<StreamUnexpectedEnd>("frame table expected");
+
+        Impl->Table.resize(count);
+        for(size_t i = 0; i < count; ++i)
+        {
+            auto e = static_cast<const uint8_t*>(ptr) + Headersize + i * Entrysize;
+            Impl->Table[i] = { read64(e), read32(e + 8), read32(e + 12) };
+        }
+
+        try
+        {
+            Impl->Base = Source->sourceOffset();
+        }
+        catch(SeekUnsupported&)
+        {
+            Impl->Base = 0;
+        }
+
+        Source->advanceBuffer(tablesize);
+        Impl->Position = Impl->Base + tablesize;
+    }
 
-    Impl = std::make_unique<ImplData>();
+    for(const auto &[p, v] : opts)
+        codecParameter(p, v);
 }
 
 Decoder::~Decoder()
@@ -52,55 +167,263 @@ void Decoder::codecLogging(CodecLoglevel, CodecLogger)
     //TODO
 }
 
-void Decoder::codecParameter(const std::string &parameter, const std::string & value)
+void Decoder::codecParameter(const std::string &parameter, const std::string &value)
 {
-    throw GenericError<UnknownParameter>(parameter);
+    if(parameter != "lookahead" && parameter != "threads")
+        throw GenericError<UnknownParameter>(parameter);
+
+    size_t n;
+    if(sscanf(value.c_str(), "%zu", &n) != 1)
+        throw GenericError<WrongParameter>(parameter);
+
+    auto pos = tellFrame();
+
+    if(parameter == "lookahead")
+        Impl->Lookahead = n;
+    else
+    {
+        Impl->Threads = n;
+        Impl->Pool.reset();
+    }
+
+    if(Impl->Lookahead > 0 && !Impl->Pool)
+        Impl->Pool = std::make_unique<Workerpool>(Impl->Threads);
+
+    seekFrame(*pos);
 }
 
-bool Decoder::fetchFrame(Videoframe &f)
+void Decoder::locate(uint64_t offset)
+{
+    if(offset == Impl->Position)
+        return;
+
+    try
+    {
+        Source->sourceSeekOffset(offset);
+        Impl->Position = offset;
+    }
+    catch(SeekUnsupported&)
+    {
+        //linear sources can still skip forward
+        if(offset < Impl->Position)
+            throw;
+
+        while(Impl->Position < offset)
+        {
+            auto[ptr, len] = Source->minimalBuffer(1);
+            if(len == 0)
+                throw GenericError<StreamUnexpectedEnd>("frame offset beyond end");
+
+            auto n = (size_t)std::min<uint64_t>(len, offset - Impl->Position);
+            Source->advanceBuffer(n);
+            Impl->Position += n;
+        }
+    }
+}
+
+bool Decoder::beginFrame(Framedata &fd)
 {
-    auto[ptr, len] = Source->minimalBuffer(4);
+    if(Impl->Version == 1)
+    {
+        auto[ptr, len] = Source->minimalBuffer(4);
+
+        if(len == 0)
+            return false;
 
-    if(len == 0)
-        return false;
+        if(len < 4)
+            throw GenericError<StreamUnexpectedEnd>("invalid frame header");
 
-    if(len < 4)
-        throw GenericError<StreamUnexpectedEnd>("invalid frame header");
+        fd.Size = static_cast<size_t>(read32(ptr));
+        fd.Tag = Codectag::Stbi;
+        fd.Offset = ~uint64_t(0);
+        fd.Shared = false;
 
-    size_t framelen = static_cast<size_t>(read32(ptr));
+        Source->advanceBuffer(4);
+    }
+    else
+    {
+        if(Impl->Next >= Impl->Table.size())
+            return false;
 
-    Source->advanceBuffer(4);
-    auto[ptr2, len2] = Source->minimalBuffer(framelen);
+        const auto &e = Impl->Table[Impl->Next++];
+        fd.Size = e.Size;
+        fd.Tag = e.Tag;
+        fd.Offset = e.Offset;
+        fd.Shared = e.Offset == Impl->Lastoffset;
 
-    if(len2 < framelen)
+        if(fd.Shared)
+            return true;
+
+        locate(Impl->Base + e.Offset);
+    }
+
+    auto[ptr, len] = Source->minimalBuffer(fd.Size);
+    if(len < fd.Size)
         throw GenericError<StreamUnexpectedEnd>("image data too short");
 
-    int sizex, sizey;
-    StbPixelptr imgptr;
-    if(imgptr.reset(stbi_load_from_memory((const stbi_uc*)ptr2, (int)len, &sizex, &sizey, nullptr, STBI_rgb_alpha)); !imgptr)
-        throw GenericError<StreamMalformed>("malformed image");
+    Codecstats::add(Impl->Stats.Units);
+    Codecstats::add(Impl->Stats.BytesConsumed, fd.Size);
+    fd.Data = ptr;
+    return true;
+}
 
-    Source->advanceBuffer(framelen);
+void Decoder::endFrame(const Framedata &fd)
+{
+    if(!fd.Shared)
+    {
+        Source->advanceBuffer(fd.Size);
+        Impl->Position += fd.Size;
+    }
 
-    Impl->Currframe = std::move(imgptr);
+    Impl->Lastoffset = fd.Offset;
+}
+
+void Decoder::fillQueue(size_t depth)
+{
+    while(Impl->Queue.size() < depth)
+    {
+        Queued q;
+        if(Impl->Version == 1)
+            q.Position = Source->sourceTell();
+        q.Frame = Impl->Next;
+
+        Framedata fd;
+        if(!beginFrame(fd))
+            break;
+
+        if(fd.Shared)
+        {
+            if(!Impl->Queue.empty())
+            {
+                q.Work = Impl->Queue.back().Work;
+                q.Done = Impl->Queue.back().Done;
+            }
+            else
+            {
+                q.Work = std::make_shared<Job>();
+                q.Work->Result = Impl->Current;
+
+                std::promise<void> ready;
+                ready.set_value();
+                q.Done = ready.get_future().share();
+            }
+        }
+        else
+        {
+            auto job = std::make_shared<Job>();
+            job->Data.assign(static_cast<const char*>(fd.Data), static_cast<const char*>(fd.Data) + fd.Size);
+            job->Tag = fd.Tag;
+
+            q.Work = job;
+            q.Done = Impl->Pool->post([job]
+            {
+                job->Result = decodeImage(job->Data.data(), job->Data.size(), job->Tag);
+                job->Data = {};
+            }).share();
+        }
+
+        endFrame(fd);
+        Impl->Queue.push_back(std::move(q));
+    }
+}
+
+bool Decoder::fetchFrame(Videoframe &f)
+{
+    Impl->Batch.clear();
+    return fetch(f, Impl->Lookahead);
+}
+
+size_t Decoder::fetchFrames(Videoframe *frames, size_t count)
+{
+    Impl->Batch.clear();
+
+    size_t n = 0;
+    for(; n < count && fetch(frames[n], std::max(Impl->Lookahead, count - n)); ++n)
+        Impl->Batch.push_back(Impl->Current.Pixels);
+
+    return n;
+}
+
+bool Decoder::fetch(Videoframe &f, size_t depth)
+{
+    auto begin = std::chrono::steady_clock::now();
+    if(Impl->Lookahead > 0)
+    {
+        fillQueue(depth);
+        if(Impl->Queue.empty())
+            return false;
+
+        auto q = std::move(Impl->Queue.front());
+        Impl->Queue.pop_front();
+
+        q.Done.get();
+        Impl->Current = q.Work->Result;
+    }
+    else
+    {
+        Framedata fd;
+        if(!beginFrame(fd))
+            return false;
+
+        if(!fd.Shared)
+            Impl->Current = decodeImage(fd.Data, fd.Size, fd.Tag);
+        endFrame(fd);
+    }
 
     f.Format = Pixelformat::RGBA32I;
-    f.Width = (unsigned int)sizex;
-    f.Height = (unsigned int)sizey;
-    f.Planes[0] = Impl->Currframe.get();
+    f.Width = Impl->Current.Width;
+    f.Height = Impl->Current.Height;
+    f.Planes[0] = Impl->Current.Pixels.get();
     f.Linestrides[0] = 0;
 
+    if(Impl->Owned)
+        f.Owner = Impl->Current.Pixels;
+    else
+        f.Owner.reset();
+
+    Impl->Stats.addDecodetime(std::chrono::steady_clock::now() - begin);
+    Codecstats::add(Impl->Stats.Frames);
     return true;
 }
 
 std::unique_ptr<ISourceSeek> Decoder::tellFrame() const
 {
-    return Source->sourceTell();
+    if(Impl->Version == 1)
+    {
+        auto s = std::make_unique<StreamSeek>();
+        if(!Impl->Queue.empty())
+            s->Position = Impl->Queue.front().Position;
+        else
+            s->Position = Source->sourceTell();
+        return s;
+    }
+
+    auto s = std::make_unique<FrameSeek>();
+    s->Frame = Impl->Queue.empty() ? Impl->Next : Impl->Queue.front().Frame;
+    return s;
 }
 
 void Decoder::seekFrame(const ISourceSeek &s)
 {
-    Source->sourceSeek(s);
+    Impl->Queue.clear();
+
+    if(Impl->Version == 1)
+        Source->sourceSeek(*static_cast<const StreamSeek&>(s).Position);
+    else
+    {
+        Impl->Next = static_cast<const FrameSeek&>(s).Frame;
+        Impl->Lastoffset = ~uint64_t(0);
+    }
+}
+
+void Decoder::codecFramepool(std::shared_ptr<Framepool> p)
+{
+    Impl->Owned = p != nullptr;
+}
+
+const Codecstats *Decoder::codecStats() const
+{
+    return &Impl->Stats;
 }
 
 }
\ No newline at end of file
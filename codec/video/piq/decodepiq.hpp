@@ -15,14 +15,32 @@ namespace mlib::codec::video::piq
 //
 // format: (little endian)
 // 'PIQ!' signature
-// [uint8] version (currently 0x01)
+// [uint8] version (0x01 or 0x02)
 // [uint32] number of frames
-// 
-// for all frames:
+//
+// version 1, for all frames:
 // [uint32] image size
 // ... image data
 //
+// version 2, frame table, for all frames:
+// [uint64] offset of frame data from the signature
+// [uint32] frame data size
+// [uint32] codec tag (see Codectag and payloadpiq.hpp)
+// followed by frame data in any order. Frames may share data.
+// Version 2 seeks by frame through the table, using sourceSeekOffset when frames are
+// not in order, and reuses the image when a frame shares the previous one's data.
+//
+// Parameters:
+// - "lookahead" (default 0) reads this many frames ahead and decodes them in parallel,
+//   returning them in order. Frame data is copied, so any source works.
+// - "threads" (default 0 for hardware threads) sets the number of look-ahead decoding threads.
+//
 // plane0 points to image RGBA pixels.
+// Images are decoded to buffers from a shared pool (see imagepiq.hpp).
+// With a frame pool set, frames own their image.
+// fetchFrames keeps the images of a batch referenced until the next call, without copying them.
+// With look-ahead, it reads up to the batch size ahead, so frames of a batch decode in parallel.
+// codecStats counts frame payloads as units, shared frames are not counted again.
 //
 
 class Decoder : public IVideoDecodec
@@ -35,15 +53,26 @@ public:
     void codecParameter(const std::string &parameter, const std::string &value) override;
 
     bool fetchFrame(Videoframe &) override;
+    size_t fetchFrames(Videoframe *frames, size_t count) override;
 
     std::unique_ptr<ISourceSeek> tellFrame() const override;
     void seekFrame(const ISourceSeek &) override;
 
+    void codecFramepool(std::shared_ptr<Framepool>) override;
+    const Codecstats *codecStats() const override;
+
 private:
+    void locate(uint64_t offset);
+    struct Framedata;
+    bool beginFrame(Framedata &fd);
+    void endFrame(const Framedata &fd);
+    void fillQueue(size_t depth);
+    bool fetch(Videoframe &f, size_t depth);
+
     ICodecSourcebuffer *Source;
     
     struct ImplData;
     std::unique_ptr<ImplData> Impl;
 };
 
-}
\ No newline at end of file
+}
\ No newline at end of file
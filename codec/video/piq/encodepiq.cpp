@@ -0,0 +1,114 @@
+#include "encodepiq.hpp"
+
+#include <cstring>
+
+namespace mlib::codec::video::piq
+{
+
+static void put32(char *p, uint32_t v)
+{
+    for(int i = 0; i < 4; ++i)
+        p[i] = static_cast<char>(v >> (i * 8));
+}
+
+static void put64(char *p, uint64_t v)
+{
+    put32(p, static_cast<uint32_t>(v));
+    put32(p + 4, static_cast<uint32_t>(v >> 32));
+}
+
+Writer::Writer(std::iostream &out, uint32_t frames) : Out(&out), Begin(out.tellp()), Frames(frames)
+{
+    std::vector<char> header(Headersize + static_cast<size_t>(frames) * Entrysize, 0);
+    std::memcpy(header.data(), "PIQ!\x02", 5);
+    put32(header.data() + 5, frames);
+
+    if(!Out->write(header.data(), header.size()))
+        throw GenericError<CodecError>("write failed");
+
+    Offset = header.size();
+    Table.reserve(frames);
+}
+
+void Writer::addFrame(const void *data, size_t size, uint32_t tag)
+{
+    if(Table.size() >= Frames)
+        throw GenericError<CodecError>("too many frames");
+    if(size > UINT32_MAX)
+        throw GenericError<CodecError>("frame too large");
+
+    //FNV-1a and a multiplicative word hash, both seeded with size and tag
+    auto p = static_cast<const unsigned char*>(data);
+    Hash h{ 0xcbf29ce484222325ull ^ size ^ (uint64_t)tag << 32, 0x9e3779b97f4a7c15ull * (size + 1) ^ tag };
+
+    for(size_t i = 0; i < size; ++i)
+        h.A = (h.A ^ p[i]) * 0x100000001b3ull;
+
+    size_t i = 0;
+    for(; i + 8 <= size; i += 8)
+    {
+        uint64_t w;
+        std::memcpy(&w, p + i, 8);
+        h.B = (h.B ^ w) * 0xff51afd7ed558ccdull;
+        h.B ^= h.B >> 29;
+    }
+    for(; i < size; ++i)
+    {
+        h.B = (h.B ^ p[i]) * 0xc4ceb9fe1a85ec53ull;
+        h.B ^= h.B >> 29;
+    }
+
+    auto [first, last] = Stored.equal_range(h);
+    for(auto it = first; it != last; ++it)
+    {
+        if(storedEqual(it->second, data, size, tag))
+        {
+            Table.push_back(it->second);
+            return;
+        }
+    }
+
+    if(!Out->write(static_cast<const char*>(data), size))
+        throw GenericError<CodecError>("write failed");
+
+    Frameentry e{ Offset, static_cast<uint32_t>(size), tag };
+    Offset += size;
+
+    Stored.emplace(h, e);
+    Table.push_back(e);
+}
+
+bool Writer::storedEqual(const Frameentry &e, const void *data, size_t size, uint32_t tag)
+{
+    if(e.Size != size || e.Tag != tag)
+        return false;
+
+    auto end = Out->tellp();
+    std::vector<char> stored(size);
+    if(!Out->flush() || !Out->seekg(Begin + static_cast<std::streamoff>(e.Offset)) || !Out->read(stored.data(), size) || !Out->seekp(end))
+        throw GenericError<CodecError>("read back failed");
+
+    return size == 0 || std::memcmp(stored.data(), data, size) == 0;
+}
+
+void Writer::finish()
+{
+    if(Table.size() != Frames)
+        throw GenericError<CodecError>("frame count mismatch");
+
+    std::vector<char> table(Table.size() * Entrysize);
+    for(size_t i = 0; i < Table.size(); ++i)
+    {
+        auto e = table.data() + i * Entrysize;
+        put64(e, Table[i].Offset);
+        put32(e + 8, Table[i].Size);
+        put32(e + 12, Table[i].Tag);
+    }
+
+    auto end = Out->tellp();
+    Out->seekp(Begin + static_cast<std::streamoff>(Headersize));
+    if(!Out->write(table.data(), table.size()) || !Out->seekp(end) || !Out->flush())
+        throw GenericError<CodecError>("write failed");
+}
+
+}
@@ -0,0 +1,61 @@
+#pragma once
+
+#include <iostream>
+#include <vector>
+#include <unordered_map>
+#include <cstdint>
+
+#include "commonpiq.hpp"
+
+namespace mlib::codec::video::piq
+{
+
+//
+// picture sequence writer (version 2)
+//
+// Writes the header and a placeholder frame table, then frame data as frames are added.
+// Frames with the same data are stored once and share it. Frames are looked up by a 128 bit
+// hash and compared with the data read back from the stream, which must therefore be readable.
+// finish writes the frame table, seeking the stream back to it, and must be called after
+// exactly the number of frames given on construction.
+//
+
+class Writer
+{
+public:
+    Writer(std::iostream &out, uint32_t frames);
+
+    void addFrame(const void *data, size_t size, uint32_t tag = Codectag::Stbi);
+    void finish();
+
+    size_t uniqueFrames() const { return Stored.size(); }
+
+    Writer(Writer&&) = delete;
+    Writer(const Writer&) = delete;
+    Writer &operator=(Writer&&) = delete;
+    Writer &operator=(const Writer&) = delete;
+
+private:
+    struct Hash
+    {
+        uint64_t A, B;
+        bool operator==(const Hash &h) const { return A == h.A && B == h.B; }
+    };
+
+    struct Hasher
+    {
+        size_t operator()(const Hash &h) const { return static_cast<size_t>(h.A); }
+    };
+
+    bool storedEqual(const Frameentry &e, const void *data, size_t size, uint32_t tag);
+
+    std::iostream *Out;
+    std::streampos Begin;
+    uint64_t Offset;
+
+    std::vector<Frameentry> Table;
+    uint32_t Frames;
+    std::unordered_multimap<Hash, Frameentry, Hasher> Stored; //frames with colliding hashes are stored each
+};
+
+}
@@ -0,0 +1,133 @@
+#include "imagepiq.hpp"
+#include "../framepool.hpp"
+
+#include <cstdlib>
+#include <cstring>
+#include <algorithm>
+
+namespace mlib::codec::video::piq
+{
+
+static Framepool &imagePool()
+{
+    static Framepool pool(4);
+    return pool;
+}
+
+//
+// allocations
+//
+// Allocations of at least Pooledsize bytes, images and decompressed data, come from the pool,
+// smaller ones such as Huffman tables from malloc. A header in front records which it was.
+//
+
+static constexpr size_t Pooledsize = 64 * 1024;
+static constexpr size_t Header = 64; //keeps pooled pixels aligned like the pool's buffers
+
+struct Allocation
+{
+    size_t Size;
+    bool Pooled;
+};
+
+static Allocation *allocationOf(void *p)
+{
+    return reinterpret_cast<Allocation*>(static_cast<char*>(p) - Header);
+}
+
+static void *imageAllocate(Framepool &pool, size_t n)
+{
+    bool pooled = n >= Pooledsize;
+    auto block = static_cast<char*>(pooled ? pool.allocate(n + Header) : std::malloc(n + Header));
+    if(!block)
+        return nullptr;
+
+    *reinterpret_cast<Allocation*>(block) = { n, pooled };
+    return block + Header;
+}
+
+static void imageFree(Framepool &pool, void *p)
+{
+    if(!p)
+        return;
+
+    auto a = allocationOf(p);
+    if(a->Pooled)
+        pool.release(a);
+    else
+        std::free(a);
+}
+
+static void *imageReallocate(Framepool &pool, void *p, size_t n)
+{
+    if(!p)
+        return imageAllocate(pool, n);
+
+    auto a = allocationOf(p);
+    if(a->Pooled == (n >= Pooledsize)) //stays on the same side, the pool keeps blocks growing within their size class
+    {
+        auto block = static_cast<Allocation*>(a->Pooled ? pool.reallocate(a, n + Header) : std::realloc(a, n + Header));
+        if(!block)
+            return nullptr;
+
+        block->Size = n;
+        return reinterpret_cast<char*>(block) + Header;
+    }
+
+    void *moved = imageAllocate(pool, n);
+    if(!moved)
+        return nullptr;
+
+    std::memcpy(moved, p, std::min(a->Size, n));
+    imageFree(pool, p);
+    return moved;
+}
+
+static void *stbMalloc(size_t n) { return imageAllocate(imagePool(), n); }
+static void *stbRealloc(void *p, size_t n) { return imageReallocate(imagePool(), p, n); }
+static void stbFree(void *p) { imageFree(imagePool(), p); }
+
+}
+
+#define STBI_MALLOC(sz) mlib::codec::video::piq::stbMalloc(sz)
+#define STBI_REALLOC(p, newsz) mlib::codec::video::piq::stbRealloc(p, newsz)
+#define STBI_FREE(p) mlib::codec::video::piq::stbFree(p)
+#define STB_IMAGE_STATIC
+#define STB_IMAGE_IMPLEMENTATION
+
+#if defined(__GNUC__)
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wunused-function"
+#endif
+#include <stb_image.h>
+#if defined(__GNUC__)
+#pragma GCC diagnostic pop
+#endif
+
+namespace mlib::codec::video::piq
+{
+
+//the deleter holds a copy of the pool, so images may outlive its static instance
+static std::shared_ptr<unsigned char> pooled(void *p)
+{
+    return std::shared_ptr<unsigned char>(static_cast<unsigned char*>(p), [pool = imagePool()](unsigned char *p) mutable { imageFree(pool, p); });
+}
+
+std::shared_ptr<unsigned char> loadImage(const void *data, size_t size, unsigned int &width, unsigned int &height)
+{
+    int sizex, sizey;
+    stbi_uc *px = stbi_load_from_memory(static_cast<const stbi_uc*>(data), (int)size, &sizex, &sizey, nullptr, STBI_rgb_alpha);
+    if(!px)
+        return nullptr;
+
+    width = (unsigned int)sizex;
+    height = (unsigned int)sizey;
+    return pooled(px);
+}
+
+std::shared_ptr<unsigned char> allocateImage(unsigned int width, unsigned int height)
+{
+    return pooled(imageAllocate(imagePool(), (size_t)width * height * 4));
+}
+
+}
@@ -0,0 +1,23 @@
+#pragma once
+
+#include <memory>
+#include <cstddef>
+
+#include "commonpiq.hpp"
+
+namespace mlib::codec::video::piq
+{
+
+//
+// pooled image buffers
+//
+// stb_image is compiled privately with its large allocations routed through a Framepool shared by
+// all decoders, so images of the same size reuse buffers instead of allocating. Small ones use malloc.
+// - loadImage decodes image data to RGBA pixels, returning nullptr if it is malformed.
+// - allocateImage returns a buffer for RGBA pixels of the given size from the same pool.
+//
+
+std::shared_ptr<unsigned char> loadImage(const void *data, size_t size, unsigned int &width, unsigned int &height);
+std::shared_ptr<unsigned char> allocateImage(unsigned int width, unsigned int height);
+
+}
@@ -0,0 +1,247 @@
+#include "payloadpiq.hpp"
+
+#include <cstring>
+#include <lz4.h>
+
+namespace mlib::codec::video::piq
+{
+
+static constexpr uint64_t Maxpixels = 400000000; //as QOI
+
+static uint32_t read32(const uint8_t *p)
+{
+    return (uint32_t)p[0] | (uint32_t)p[1] << 8 | (uint32_t)p[2] << 16 | (uint32_t)p[3] << 24;
+}
+
+static uint32_t read32be(const uint8_t *p)
+{
+    return (uint32_t)p[3] | (uint32_t)p[2] << 8 | (uint32_t)p[1] << 16 | (uint32_t)p[0] << 24;
+}
+
+static void put32(std::vector<char> &v, uint32_t n, bool bigendian = false)
+{
+    for(int i = 0; i < 4; ++i)
+        v.push_back(static_cast<char>(n >> (bigendian ? 24 - i * 8 : i * 8)));
+}
+
+//
+// QOI
+//
+
+static constexpr size_t Qoiheader = 14, Qoipadding = 8;
+
+static unsigned int qoiHash(const uint8_t *px)
+{
+    return (px[0] * 3 + px[1] * 5 + px[2] * 7 + px[3] * 11) % 64;
+}
+
+static void decodeQoi(const uint8_t *p, size_t size, size_t pixels, unsigned char *out)
+{
+    uint8_t index[64][4] = {};
+    uint8_t px[4] = { 0, 0, 0, 255 };
+    size_t pos = Qoiheader, end = size - Qoipadding;
+    unsigned int run = 0;
+
+    for(size_t i = 0; i < pixels; ++i, out += 4)
+    {
+        if(run > 0)
+            --run;
+        else
+        {
+            if(pos >= end)
+                throw GenericError<StreamMalformed>("qoi data too short");
+
+            uint8_t b1 = p[pos++];
+            if(b1 == 0xfe || b1 == 0xff)
+            {
+                size_t n = b1 == 0xfe ? 3 : 4;
+                if(end - pos < n)
+                    throw GenericError<StreamMalformed>("qoi data too short");
+                std::memcpy(px, p + pos, n);
+                pos += n;
+            }
+            else switch(b1 >> 6)
+            {
+            case 0:
+                std::memcpy(px, index[b1], 4);
+                break;
+            case 1:
+                px[0] = static_cast<uint8_t>(px[0] + ((b1 >> 4) & 3) - 2);
+                px[1] = static_cast<uint8_t>(px[1] + ((b1 >> 2) & 3) - 2);
+                px[2] = static_cast<uint8_t>(px[2] + (b1 & 3) - 2);
+                break;
+            case 2:
+            {
+                if(pos >= end)
+                    throw GenericError<StreamMalformed>("qoi data too short");
+                uint8_t b2 = p[pos++];
+                int vg = (b1 & 0x3f) - 32;
+                px[0] = static_cast<uint8_t>(px[0] + vg - 8 + ((b2 >> 4) & 0x0f));
+                px[1] = static_cast<uint8_t>(px[1] + vg);
+                px[2] = static_cast<uint8_t>(px[2] + vg - 8 + (b2 & 0x0f));
+                break;
+            }
+            default:
+                run = b1 & 0x3f;
+                break;
+            }
+
+            std::memcpy(index[qoiHash(px)], px, 4);
+        }
+
+        std::memcpy(out, px, 4);
+    }
+}
+
+static std::vector<char> encodeQoi(const unsigned char *rgba, unsigned int width, unsigned int height)
+{
+    std::vector<char> v;
+    v.reserve(Qoiheader + (size_t)width * height * 5 + Qoipadding);
+    v.insert(v.end(), { 'q', 'o', 'i', 'f' });
+    put32(v, width, true);
+    put32(v, height, true);
+    v.push_back(4); //channels
+    v.push_back(0); //sRGB
+
+    uint8_t index[64][4] = {};
+    uint8_t prev[4] = { 0, 0, 0, 255 };
+    unsigned int run = 0;
+    size_t pixels = (size_t)width * height;
+
+    for(size_t i = 0; i < pixels; ++i)
+    {
+        const uint8_t *px = rgba + i * 4;
+
+        if(std::memcmp(px, prev, 4) == 0)
+        {
+            if(++run == 62 || i + 1 == pixels)
+            {
+                v.push_back(static_cast<char>(0xc0 | (run - 1)));
+                run = 0;
+            }
+            continue;
+        }
+
+        if(run > 0)
+        {
+            v.push_back(static_cast<char>(0xc0 | (run - 1)));
+            run = 0;
+        }
+
+        auto h = qoiHash(px);
+        if(std::memcmp(index[h], px, 4) == 0)
+            v.push_back(static_cast<char>(h));
+        else
+        {
+            std::memcpy(index[h], px, 4);
+
+            if(px[3] == prev[3])
+            {
+                int vr = static_cast<int8_t>(px[0] - prev[0]);
+                int vg = static_cast<int8_t>(px[1] - prev[1]);
+                int vb = static_cast<int8_t>(px[2] - prev[2]);
+                int vgr = vr - vg, vgb = vb - vg;
+
+                if(vr > -3 && vr < 2 && vg > -3 && vg < 2 && vb > -3 && vb < 2)
+                    v.push_back(static_cast<char>(0x40 | (vr + 2) << 4 | (vg + 2) << 2 | (vb + 2)));
+                else if(vgr > -9 && vgr < 8 && vg > -33 && vg < 32 && vgb > -9 && vgb < 8)
+                {
+                    v.push_back(static_cast<char>(0x80 | (vg + 32)));
+                    v.push_back(static_cast<char>((vgr + 8) << 4 | (vgb + 8)));
+                }
+                else
+                    v.insert(v.end(), { static_cast<char>(0xfe), (char)px[0], (char)px[1], (char)px[2] });
+            }
+            else
+                v.insert(v.end(), { static_cast<char>(0xff), (char)px[0], (char)px[1], (char)px[2], (char)px[3] });
+        }
+
+        std::memcpy(prev, px, 4);
+    }
+
+    v.insert(v.end(), { 0, 0, 0, 0, 0, 0, 0, 1 });
+    return v;
+}
+
+//
+// payloads
+//
+
+void payloadDimensions(const void *data, size_t size, uint32_t tag, unsigned int &width, unsigned int &height)
+{
+    auto p = static_cast<const uint8_t*>(data);
+
+    if(tag == Codectag::Raw || tag == Codectag::Lz4)
+    {
+        if(size < 8)
+            throw GenericError<StreamMalformed>("payload header too short");
+
+        width = read32(p);
+        height = read32(p + 4);
+    }
+    else if(tag == Codectag::Qoi)
+    {
+        if(size < Qoiheader + Qoipadding || std::memcmp(p, "qoif", 4) != 0)
+            throw GenericError<StreamMalformed>("invalid qoi header");
+
+        width = read32be(p + 4);
+        height = read32be(p + 8);
+    }
+    else
+        throw GenericError<StreamMalformed>("unknown codec tag");
+
+    if(width == 0 || height == 0 || (uint64_t)width * height > Maxpixels)
+        throw GenericError<StreamMalformed>("invalid image size");
+}
+
+void decodePayload(const void *data, size_t size, uint32_t tag, unsigned char *rgba)
+{
+    unsigned int width, height;
+    payloadDimensions(data, size, tag, width, height);
+
+    auto p = static_cast<const uint8_t*>(data);
+    size_t bytes = (size_t)width * height * 4;
+
+    if(tag == Codectag::Raw)
+    {
+        if(size - 8 < bytes)
+            throw GenericError<StreamMalformed>("image data too short");
+        std::memcpy(rgba, p + 8, bytes);
+    }
+    else if(tag == Codectag::Lz4)
+    {
+        if(LZ4_decompress_safe(reinterpret_cast<const char*>(p + 8), reinterpret_cast<char*>(rgba), (int)(size - 8), (int)bytes) != (int)bytes)
+            throw GenericError<StreamMalformed>("malformed lz4 data");
+    }
+    else
+        decodeQoi(p, size, bytes / 4, rgba);
+}
+
+std::vector<char> encodePayload(const unsigned char *rgba, unsigned int width, unsigned int height, uint32_t tag)
+{
+    size_t bytes = (size_t)width * height * 4;
+
+    if(tag == Codectag::Qoi)
+        return encodeQoi(rgba, width, height);
+
+    std::vector<char> v;
+    put32(v, width);
+    put32(v, height);
+
+    if(tag == Codectag::Raw)
+        v.insert(v.end(), reinterpret_cast<const char*>(rgba), reinterpret_cast<const char*>(rgba) + bytes);
+    else if(tag == Codectag::Lz4)
+    {
+        v.resize(8 + LZ4_compressBound((int)bytes));
+        int n = LZ4_compress_default(reinterpret_cast<const char*>(rgba), v.data() + 8, (int)bytes, (int)(v.size() - 8));
+        if(n <= 0)
+            throw GenericError<CodecError>("lz4 compression failed");
+        v.resize(8 + n);
+    }
+    else
+        throw GenericError<CodecError>("unknown codec tag");
+
+    return v;
+}
+
+}
@@ -0,0 +1,28 @@
+#pragma once
+
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+
+#include "commonpiq.hpp"
+
+namespace mlib::codec::video::piq
+{
+
+//
+// frame payloads besides stb_image data
+//
+// Codectag::Raw: [uint32] width, [uint32] height, RGBA pixels
+// Codectag::Qoi: QOI image (qoiformat.org), decoded to RGBA
+// Codectag::Lz4: [uint32] width, [uint32] height, LZ4 block of RGBA pixels
+//
+// - payloadDimensions reads a payload's size in pixels, throwing StreamMalformed if it is too short.
+// - decodePayload decodes a payload into rgba, which holds width * height * 4 bytes.
+// - encodePayload encodes RGBA pixels as payload of the given tag.
+//
+
+void payloadDimensions(const void *data, size_t size, uint32_t tag, unsigned int &width, unsigned int &height);
+void decodePayload(const void *data, size_t size, uint32_t tag, unsigned char *rgba);
+std::vector<char> encodePayload(const unsigned char *rgba, unsigned int width, unsigned int height, uint32_t tag);
+
+}
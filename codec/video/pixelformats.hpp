@@ -9,13 +9,20 @@ namespace mlib::codec::video
 // pixel formats and layouts
 //
 // <components><bits per pixel><planar (P)|interleaved (I)|semiplanar (S)>
+// Interleaved layouts name their components in byte order in memory, RGBA32I being R,G,B,A
+// as decoded by stb_image. RGB16I is RGB565 in little-endian 16 bit words, red in the high bits.
 //
     
 enum class Pixelformat
 {
-    YUV12P,
+    YUV12P,     //I420
     RGBA32I,
-    RGB24I
+    RGB24I,
+    YUV12S,     //NV12, Y plane and interleaved UV plane
+    BGRA32I,
+    YUV24P,     //I444
+    Y8P,        //GRAY8
+    RGB16I      //RGB565
 };
 
 }
\ No newline at end of file
@@ -1,15 +1,402 @@
 #include "pxconv.hpp"
 
+#include "framepool.hpp"
+#include "frameutil.hpp"
+#include "workerpool.hpp"
+#include "codecstats.hpp"
+
 #include <utility>
+#include <future>
+#include <algorithm>
+#include <chrono>
+#include <exception>
+#include <limits>
+#include <cstdio>
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
 #include <libyuv.h>
 
 namespace mlib::codec::video
 {
 
-Pxconv::Pxconv(IVideoDecodec &source, Pixelformat destfmt) : Source(&source), Format(destfmt)
+namespace
+{
+
+//
+// conversion graph
+//
+// Each conversion converts a band of rows given by plane pointers at its first row.
+// Costs are rough relative per-pixel estimates; repacks between interleaved formats
+// avoid the chroma loss of a detour through YUV12P.
+//
+
+struct Band
+{
+    const uint8_t *Src[3];
+    int Srcstride[3];
+    uint8_t *Dst[3];
+    int Dststride[3];
+    int Width, Rows;
+};
+
+struct Conversion
+{
+    Pixelformat From, To;
+    unsigned int Cost;
+    void (*Convert)(const Band&);
+};
+
+constexpr size_t Formatcount = 8;
+
+//formats name their bytes in memory, libyuv names little-endian words:
+//RGBA32I is libyuv ABGR, BGRA32I is ARGB, RGB24I is RAW
+const uint8_t SwapRB[16] = { 2, 1, 0, 3, 6, 5, 4, 7, 10, 9, 8, 11, 14, 13, 12, 15 };
+
+void rgbaToRgb24(const Band &b)
+{
+    for(int y = 0; y < b.Rows; ++y)
+    {
+        auto src = b.Src[0] + y * b.Srcstride[0];
+        auto dst = b.Dst[0] + y * b.Dststride[0];
+        for(int x = 0; x < b.Width; ++x, src += 4, dst += 3)
+        {
+            dst[0] = src[0];
+            dst[1] = src[1];
+            dst[2] = src[2];
+        }
+    }
+}
+
+void rgb24ToRgba(const Band &b)
+{
+    for(int y = 0; y < b.Rows; ++y)
+    {
+        auto src = b.Src[0] + y * b.Srcstride[0];
+        auto dst = b.Dst[0] + y * b.Dststride[0];
+        for(int x = 0; x < b.Width; ++x, src += 3, dst += 4)
+        {
+            dst[0] = src[0];
+            dst[1] = src[1];
+            dst[2] = src[2];
+            dst[3] = 255;
+        }
+    }
+}
+
+void rgbaToRgb565(const Band &b)
 {
+    for(int y = 0; y < b.Rows; ++y)
+    {
+        auto src = b.Src[0] + y * b.Srcstride[0];
+        auto dst = b.Dst[0] + y * b.Dststride[0];
+        for(int x = 0; x < b.Width; ++x, src += 4, dst += 2)
+        {
+            unsigned px = (src[2] >> 3) | ((src[1] >> 2) << 5) | ((src[0] >> 3) << 11);
+            dst[0] = (uint8_t)px;
+            dst[1] = (uint8_t)(px >> 8);
+        }
+    }
+}
+
+void rgb565ToRgba(const Band &b)
+{
+    for(int y = 0; y < b.Rows; ++y)
+    {
+        auto src = b.Src[0] + y * b.Srcstride[0];
+        auto dst = b.Dst[0] + y * b.Dststride[0];
+        for(int x = 0; x < b.Width; ++x, src += 2, dst += 4)
+        {
+            unsigned px = src[0] | (src[1] << 8);
+            unsigned bl = px & 0x1f, g = (px >> 5) & 0x3f, r = px >> 11;
+            dst[0] = (uint8_t)((r << 3) | (r >> 2));
+            dst[1] = (uint8_t)((g << 2) | (g >> 4));
+            dst[2] = (uint8_t)((bl << 3) | (bl >> 2));
+            dst[3] = 255;
+        }
+    }
 }
 
+const Conversion Conversions[] =
+{
+    { Pixelformat::YUV12P, Pixelformat::RGBA32I, 4, [](const Band &b)
+    {
+        libyuv::I420ToABGR(b.Src[0], b.Srcstride[0], b.Src[1], b.Srcstride[1], b.Src[2], b.Srcstride[2],
+            b.Dst[0], b.Dststride[0], b.Width, b.Rows);
+    } },
+    { Pixelformat::YUV12P, Pixelformat::BGRA32I, 4, [](const Band &b)
+    {
+        libyuv::I420ToARGB(b.Src[0], b.Srcstride[0], b.Src[1], b.Srcstride[1], b.Src[2], b.Srcstride[2],
+            b.Dst[0], b.Dststride[0], b.Width, b.Rows);
+    } },
+    { Pixelformat::YUV12P, Pixelformat::RGB24I, 4, [](const Band &b)
+    {
+        libyuv::I420ToRAW(b.Src[0], b.Srcstride[0], b.Src[1], b.Srcstride[1], b.Src[2], b.Srcstride[2],
+            b.Dst[0], b.Dststride[0], b.Width, b.Rows);
+    } },
+    { Pixelformat::YUV12P, Pixelformat::RGB16I, 4, [](const Band &b)
+    {
+        libyuv::I420ToRGB565(b.Src[0], b.Srcstride[0], b.Src[1], b.Srcstride[1], b.Src[2], b.Srcstride[2],
+            b.Dst[0], b.Dststride[0], b.Width, b.Rows);
+    } },
+    { Pixelformat::YUV12P, Pixelformat::YUV12S, 1, [](const Band &b)
+    {
+        libyuv::I420ToNV12(b.Src[0], b.Srcstride[0], b.Src[1], b.Srcstride[1], b.Src[2], b.Srcstride[2],
+            b.Dst[0], b.Dststride[0], b.Dst[1], b.Dststride[1], b.Width, b.Rows);
+    } },
+    { Pixelformat::YUV12P, Pixelformat::YUV24P, 2, [](const Band &b)
+    {
+        libyuv::I420ToI444(b.Src[0], b.Srcstride[0], b.Src[1], b.Srcstride[1], b.Src[2], b.Srcstride[2],
+            b.Dst[0], b.Dststride[0], b.Dst[1], b.Dststride[1], b.Dst[2], b.Dststride[2], b.Width, b.Rows);
+    } },
+    { Pixelformat::YUV12P, Pixelformat::Y8P, 1, [](const Band &b)
+    {
+        libyuv::CopyPlane(b.Src[0], b.Srcstride[0], b.Dst[0], b.Dststride[0], b.Width, b.Rows);
+    } },
+    { Pixelformat::YUV12S, Pixelformat::YUV12P, 1, [](const Band &b)
+    {
+        libyuv::NV12ToI420(b.Src[0], b.Srcstride[0], b.Src[1], b.Srcstride[1],
+            b.Dst[0], b.Dststride[0], b.Dst[1], b.Dststride[1], b.Dst[2], b.Dststride[2], b.Width, b.Rows);
+    } },
+    { Pixelformat::YUV12S, Pixelformat::RGB24I, 4, [](const Band &b)
+    {
+        libyuv::NV12ToRAW(b.Src[0], b.Srcstride[0], b.Src[1], b.Srcstride[1], b.Dst[0], b.Dststride[0], b.Width, b.Rows);
+    } },
+    { Pixelformat::YUV12S, Pixelformat::RGB16I, 4, [](const Band &b)
+    {
+        libyuv::NV12ToRGB565(b.Src[0], b.Srcstride[0], b.Src[1], b.Srcstride[1], b.Dst[0], b.Dststride[0], b.Width, b.Rows);
+    } },
+    { Pixelformat::YUV12S, Pixelformat::Y8P, 1, [](const Band &b)
+    {
+        libyuv::CopyPlane(b.Src[0], b.Srcstride[0], b.Dst[0], b.Dststride[0], b.Width, b.Rows);
+    } },
+    { Pixelformat::YUV24P, Pixelformat::YUV12P, 2, [](const Band &b)
+    {
+        libyuv::I444ToI420(b.Src[0], b.Srcstride[0], b.Src[1], b.Srcstride[1], b.Src[2], b.Srcstride[2],
+            b.Dst[0], b.Dststride[0], b.Dst[1], b.Dststride[1], b.Dst[2], b.Dststride[2], b.Width, b.Rows);
+    } },
+    { Pixelformat::YUV24P, Pixelformat::Y8P, 1, [](const Band &b)
+    {
+        libyuv::CopyPlane(b.Src[0], b.Srcstride[0], b.Dst[0], b.Dststride[0], b.Width, b.Rows);
+    } },
+    { Pixelformat::Y8P, Pixelformat::YUV12P, 1, [](const Band &b)
+    {
+        libyuv::I400ToI420(b.Src[0], b.Srcstride[0],
+            b.Dst[0], b.Dststride[0], b.Dst[1], b.Dststride[1], b.Dst[2], b.Dststride[2], b.Width, b.Rows);
+    } },
+    { Pixelformat::RGBA32I, Pixelformat::YUV12P, 4, [](const Band &b)
+    {
+        libyuv::ABGRToI420(b.Src[0], b.Srcstride[0],
+            b.Dst[0], b.Dststride[0], b.Dst[1], b.Dststride[1], b.Dst[2], b.Dststride[2], b.Width, b.Rows);
+    } },
+    { Pixelformat::BGRA32I, Pixelformat::YUV12P, 4, [](const Band &b)
+    {
+        libyuv::ARGBToI420(b.Src[0], b.Srcstride[0],
+            b.Dst[0], b.Dststride[0], b.Dst[1], b.Dststride[1], b.Dst[2], b.Dststride[2], b.Width, b.Rows);
+    } },
+    { Pixelformat::RGB24I, Pixelformat::YUV12P, 4, [](const Band &b)
+    {
+        libyuv::RAWToI420(b.Src[0], b.Srcstride[0],
+            b.Dst[0], b.Dststride[0], b.Dst[1], b.Dststride[1], b.Dst[2], b.Dststride[2], b.Width, b.Rows);
+    } },
+    { Pixelformat::RGB16I, Pixelformat::YUV12P, 4, [](const Band &b)
+    {
+        libyuv::RGB565ToI420(b.Src[0], b.Srcstride[0],
+            b.Dst[0], b.Dststride[0], b.Dst[1], b.Dststride[1], b.Dst[2], b.Dststride[2], b.Width, b.Rows);
+    } },
+    { Pixelformat::RGBA32I, Pixelformat::BGRA32I, 1, [](const Band &b)
+    {
+        libyuv::ARGBShuffle(b.Src[0], b.Srcstride[0], b.Dst[0], b.Dststride[0], SwapRB, b.Width, b.Rows);
+    } },
+    { Pixelformat::BGRA32I, Pixelformat::RGBA32I, 1, [](const Band &b)
+    {
+        libyuv::ARGBShuffle(b.Src[0], b.Srcstride[0], b.Dst[0], b.Dststride[0], SwapRB, b.Width, b.Rows);
+    } },
+    { Pixelformat::RGBA32I, Pixelformat::RGB24I, 2, rgbaToRgb24 },
+    { Pixelformat::RGB24I, Pixelformat::RGBA32I, 2, rgb24ToRgba },
+    { Pixelformat::RGBA32I, Pixelformat::RGB16I, 2, rgbaToRgb565 },
+    { Pixelformat::RGB16I, Pixelformat::RGBA32I, 2, rgb565ToRgba },
+};
+
+//
+// cheapest conversion paths, computed once for all format pairs
+//
+
+struct Route
+{
+    unsigned int Cost = 0;
+    size_t Steps = 0;
+    const Conversion *Path[Formatcount];
+};
+
+const Route &route(Pixelformat from, Pixelformat to)
+{
+    static const auto routes = []
+    {
+        constexpr unsigned int none = std::numeric_limits<unsigned int>::max();
+        unsigned int cost[Formatcount][Formatcount];
+        const Conversion *next[Formatcount][Formatcount] = {};
+
+        for(size_t i = 0; i < Formatcount; ++i)
+            for(size_t j = 0; j < Formatcount; ++j)
+                cost[i][j] = i == j ? 0 : none;
+
+        for(auto &c : Conversions)
+        {
+            auto i = (size_t)c.From, j = (size_t)c.To;
+            if(c.Cost < cost[i][j])
+            {
+                cost[i][j] = c.Cost;
+                next[i][j] = &c;
+            }
+        }
+
+        for(size_t k = 0; k < Formatcount; ++k)
+            for(size_t i = 0; i < Formatcount; ++i)
+                for(size_t j = 0; j < Formatcount; ++j)
+                    if(cost[i][k] != none && cost[k][j] != none && cost[i][k] + cost[k][j] < cost[i][j])
+                    {
+                        cost[i][j] = cost[i][k] + cost[k][j];
+                        next[i][j] = next[i][k];
+                    }
+
+        std::vector<Route> r(Formatcount * Formatcount);
+        for(size_t i = 0; i < Formatcount; ++i)
+            for(size_t j = 0; j < Formatcount; ++j)
+            {
+                auto &rt = r[i * Formatcount + j];
+                rt.Cost = cost[i][j];
+                for(size_t at = i; at != j && next[at][j]; at = (size_t)next[at][j]->To)
+                    rt.Path[rt.Steps++] = next[at][j];
+            }
+
+        return r;
+    }();
+
+    return routes[(size_t)from * Formatcount + (size_t)to];
+}
+
+//with flip, the band is written to the mirrored rows of dst
+Band band(const Videoframe &src, const Videoframe &dst, unsigned int y, unsigned int rows, bool flip)
+{
+    Band b{};
+    b.Width = (int)src.Width;
+    b.Rows = (int)rows;
+
+    for(size_t p = 0; p < planeCount(src.Format); ++p)
+    {
+        auto stride = planeStride(src, p);
+        b.Src[p] = static_cast<const uint8_t*>(src.Planes[p]) + planeRows(src.Format, y, p) * stride;
+        b.Srcstride[p] = (int)stride;
+    }
+
+    for(size_t p = 0; p < planeCount(dst.Format); ++p)
+    {
+        auto stride = planeStride(dst, p);
+        auto row = planeRows(dst.Format, y, p);
+        if(flip)
+            row = planeRows(dst.Format, dst.Height, p) - 1 - row;
+
+        b.Dst[p] = (uint8_t*)dst.Planes[p] + row * stride;
+        b.Dststride[p] = flip ? -(int)stride : (int)stride;
+    }
+
+    return b;
+}
+
+void copyBand(const Band &b, Pixelformat fmt, unsigned int y)
+{
+    for(size_t p = 0; p < planeCount(fmt); ++p)
+    {
+        auto rowbytes = planeRowbytes(fmt, (unsigned int)b.Width, p);
+        auto rows = planeRows(fmt, y + (unsigned int)b.Rows, p) - planeRows(fmt, y, p);
+
+        for(unsigned int r = 0; r < rows; ++r)
+            std::memcpy(b.Dst[p] + (ptrdiff_t)r * b.Dststride[p], b.Src[p] + (ptrdiff_t)r * b.Srcstride[p], rowbytes);
+    }
+}
+
+bool scalable(Pixelformat fmt)
+{
+    switch(fmt)
+    {
+    case Pixelformat::YUV12P:
+    case Pixelformat::YUV12S:
+    case Pixelformat::YUV24P:
+    case Pixelformat::Y8P:
+    case Pixelformat::RGBA32I:
+    case Pixelformat::BGRA32I:
+        return true;
+    default:
+        return false;
+    }
+}
+
+//scalable format to scale in on the way from one format to another
+Pixelformat scalableFormat(Pixelformat from, Pixelformat to)
+{
+    if(scalable(from))
+        return from;
+    if(scalable(to))
+        return to;
+
+    auto best = Pixelformat::YUV12P;
+    unsigned int bestcost = std::numeric_limits<unsigned int>::max();
+    for(size_t i = 0; i < Formatcount; ++i)
+    {
+        auto fmt = (Pixelformat)i;
+        auto &in = route(from, fmt), &out = route(fmt, to);
+        if(scalable(fmt) && in.Steps && out.Steps && in.Cost + out.Cost < bestcost)
+        {
+            best = fmt;
+            bestcost = in.Cost + out.Cost;
+        }
+    }
+
+    return best;
+}
+
+//with flip, dst receives the source upside down
+void scaleFrame(const Videoframe &src, const Videoframe &dst, bool flip)
+{
+    auto b = band(src, dst, 0, dst.Height, false);
+    int sw = (int)src.Width, sh = flip ? -(int)src.Height : (int)src.Height;
+    int dw = (int)dst.Width, dh = (int)dst.Height;
+
+    switch(src.Format)
+    {
+    case Pixelformat::YUV12P:
+        libyuv::I420Scale(b.Src[0], b.Srcstride[0], b.Src[1], b.Srcstride[1], b.Src[2], b.Srcstride[2], sw, sh,
+            b.Dst[0], b.Dststride[0], b.Dst[1], b.Dststride[1], b.Dst[2], b.Dststride[2], dw, dh, libyuv::kFilterBox);
+        break;
+    case Pixelformat::YUV12S:
+        libyuv::NV12Scale(b.Src[0], b.Srcstride[0], b.Src[1], b.Srcstride[1], sw, sh,
+            b.Dst[0], b.Dststride[0], b.Dst[1], b.Dststride[1], dw, dh, libyuv::kFilterBox);
+        break;
+    case Pixelformat::YUV24P:
+        for(size_t p = 0; p < 3; ++p)
+            libyuv::ScalePlane(b.Src[p], b.Srcstride[p], sw, sh, b.Dst[p], b.Dststride[p], dw, dh, libyuv::kFilterBox);
+        break;
+    case Pixelformat::Y8P:
+        libyuv::ScalePlane(b.Src[0], b.Srcstride[0], sw, sh, b.Dst[0], b.Dststride[0], dw, dh, libyuv::kFilterBox);
+        break;
+    case Pixelformat::RGBA32I:
+    case Pixelformat::BGRA32I:
+        libyuv::ARGBScale(b.Src[0], b.Srcstride[0], sw, sh, b.Dst[0], b.Dststride[0], dw, dh, libyuv::kFilterBox);
+        break;
+    default:
+        throw InfeasibleConversion();
+    }
+}
+
+}
+
+Pxconv::Pxconv(IVideoDecodec &source, Pixelformat destfmt) : Source(&source), Format(destfmt), Stats(std::make_unique<Codecstats>())
+{
+}
+
+Pxconv::~Pxconv() = default;
+
 void Pxconv::codecLogging(CodecLoglevel lvl, CodecLogger lg)
 {
     Source->codecLogging(lvl, std::move(lg));
@@ -17,54 +404,319 @@ void Pxconv::codecLogging(CodecLoglevel lvl, CodecLogger lg)
 
 void Pxconv::codecParameter(const std::string &parameter, const std::string &value)
 {
-    Source->codecParameter(parameter, value);
+    if(parameter == "convthreads")
+    {
+        size_t threads;
+        if(sscanf(value.c_str(), "%zu", &threads) != 1)
+            throw GenericCodecError<WrongParameter>("pxconv", parameter);
+
+        if(threads == 1)
+            Pool.reset();
+        else
+            Pool = std::make_unique<Workerpool>(threads);
+    }
+    else if(parameter == "size")
+    {
+        unsigned int w, h;
+        if(sscanf(value.c_str(), "%ux%u", &w, &h) != 2 || (w == 0) != (h == 0))
+            throw GenericCodecError<WrongParameter>("pxconv", parameter);
+
+        Width = w;
+        Height = h;
+    }
+    else if(parameter == "crop")
+    {
+        Croprect c;
+        if(sscanf(value.c_str(), "%u,%u,%u,%u", &c.X, &c.Y, &c.Width, &c.Height) != 4 || (c.Width == 0) != (c.Height == 0))
+            throw GenericCodecError<WrongParameter>("pxconv", parameter);
+
+        Crop = c;
+    }
+    else if(parameter == "flip")
+    {
+        int flip;
+        if(sscanf(value.c_str(), "%d", &flip) != 1)
+            throw GenericCodecError<WrongParameter>("pxconv", parameter);
+
+        Flip = flip != 0;
+    }
+    else
+        Source->codecParameter(parameter, value);
+}
+
+void Pxconv::codecFramepool(std::shared_ptr<Framepool> p)
+{
+    Buffers = std::move(p);
+}
+
+char *Pxconv::outputBuffer(Videoframe &f, size_t bytes, Framepool *pool)
+{
+    if(pool)
+    {
+        auto buf = pool->acquire(bytes);
+        char *ptr = buf.get();
+        f.Owner = std::move(buf);
+        return ptr;
+    }
+
+    f.Owner.reset();
+    if(bytes > Buffer.size())
+        Buffer.resize(bytes);
+    return Buffer.data();
+}
+
+Videoframe Pxconv::outputFrame(Videoframe &f, unsigned int width, unsigned int height, void *dest, size_t stride, Framepool *pool)
+{
+    if(dest)
+    {
+        f = layoutFrame(Format, width, height, dest, stride);
+        return f;
+    }
+
+    dest = outputBuffer(f, frameBytes(Format, width, height), pool);
+
+    auto owner = std::move(f.Owner);
+    f = layoutFrame(Format, width, height, dest);
+    f.Owner = std::move(owner);
+    return f;
+}
+
+Videoframe Pxconv::scratchFrame(size_t slot, Pixelformat fmt, unsigned int width, unsigned int height)
+{
+    if(Scratch.size() <= slot)
+        Scratch.resize(slot + 1);
+
+    auto bytes = frameBytes(fmt, width, height);
+    if(bytes > Scratch[slot].size())
+        Scratch[slot].resize(bytes);
+
+    return layoutFrame(fmt, width, height, Scratch[slot].data());
+}
+
+Videoframe Pxconv::cropFrame(const Videoframe &f) const
+{
+    if(Crop.Width == 0)
+        return f;
+
+    //whole chroma samples
+    unsigned int x = std::min(Crop.X & ~1u, f.Width & ~1u), y = std::min(Crop.Y & ~1u, f.Height & ~1u);
+
+    Videoframe c = f;
+    c.Width = std::min(Crop.Width, f.Width - x);
+    c.Height = std::min(Crop.Height, f.Height - y);
+
+    for(size_t p = 0; p < planeCount(f.Format); ++p)
+    {
+        auto stride = planeStride(f, p);
+        c.Planes[p] = static_cast<const char*>(f.Planes[p]) + planeRows(f.Format, y, p) * stride + planeRowbytes(f.Format, x, p);
+        c.Linestrides[p] = stride;
+    }
+
+    return c;
+}
+
+void Pxconv::convertFrame(const Videoframe &src, const Videoframe &dst, bool flip, bool banded)
+{
+    auto &rt = route(src.Format, dst.Format);
+    if(rt.Steps == 0)
+    {
+        if(src.Format != dst.Format)
+            throw InfeasibleConversion();
+
+        convertBands(src.Height, [&](unsigned y, unsigned rows)
+        {
+            copyBand(band(src, dst, y, rows, flip), src.Format, y);
+        }, banded);
+        return;
+    }
+
+    //intermediate formats are kept in scratch buffers, bands run all steps in turn
+    Videoframe steps[Formatcount + 1];
+    steps[0] = src;
+    for(size_t i = 1; i < rt.Steps; ++i)
+        steps[i] = scratchFrame(Scratchsteps + i, rt.Path[i - 1]->To, src.Width, src.Height);
+    steps[rt.Steps] = dst;
+
+    convertBands(src.Height, [&](unsigned y, unsigned rows)
+    {
+        for(size_t i = 0; i < rt.Steps; ++i)
+            rt.Path[i]->Convert(band(steps[i], steps[i + 1], y, rows, flip && i + 1 == rt.Steps));
+    }, banded);
+}
+
+void Pxconv::convertBands(unsigned height, const std::function<void(unsigned, unsigned)> &convert, bool banded)
+{
+    size_t bands = Pool && banded ? Pool->size() : 1;
+    unsigned rows = (unsigned)((height + bands - 1) / bands + 1) & ~1u; //whole chroma rows
+
+    if(bands <= 1 || rows >= height)
+    {
+        convert(0, height);
+        return;
+    }
+
+    std::vector<std::future<void>> jobs;
+    for(unsigned y = rows; y < height; y += rows)
+        jobs.push_back(Pool->post([&convert, y, n = std::min(rows, height - y)]{ convert(y, n); }));
+
+    convert(0, rows);
+    for(auto &j : jobs)
+        j.get();
 }
 
 bool Pxconv::fetchFrame(Videoframe &f)
 {
+    return fetch(f, nullptr, 0);
+}
+
+bool Pxconv::fetchFrameInto(Videoframe &f, void *dest, size_t stride)
+{
+    return fetch(f, dest, stride);
+}
+
+bool Pxconv::fetch(Videoframe &f, void *dest, size_t stride)
+{
+    auto srcstats = Source->codecStats();
+    uint64_t dropped = srcstats ? srcstats->Dropped.load(std::memory_order_relaxed) : 0;
+    uint64_t skipped = srcstats ? srcstats->Skipped.load(std::memory_order_relaxed) : 0;
+
     Videoframe fr;
-    if(!Source->fetchFrame(fr))
+    bool success = Source->fetchFrame(fr);
+    if(srcstats)
+    {
+        Codecstats::add(Stats->Dropped, srcstats->Dropped.load(std::memory_order_relaxed) - dropped);
+        Codecstats::add(Stats->Skipped, srcstats->Skipped.load(std::memory_order_relaxed) - skipped);
+    }
+    if(!success)
         return false;
 
-    f = fr;
-    f.Format = Format;
+    auto begin = std::chrono::steady_clock::now();
+    convert(fr, f, dest, stride, Buffers.get());
 
-    if(Format == Pixelformat::RGB24I && fr.Format == Pixelformat::YUV12P)
-    {
-        if(fr.Width * fr.Height * 3 > Buffer.size())
-            Buffer.resize(fr.Width * fr.Height * 3);
+    Stats->addDecodetime(std::chrono::steady_clock::now() - begin);
+    Codecstats::add(Stats->Frames);
+    Codecstats::add(Stats->BytesConsumed, frameBytes(fr.Format, fr.Width, fr.Height));
+    return true;
+}
 
-        libyuv::I420ToRGB24((uint8_t*)fr.Planes[0], (int)fr.Linestrides[0],
-            (uint8_t*)fr.Planes[1], (int)fr.Linestrides[1],
-            (uint8_t*)fr.Planes[2], (int)fr.Linestrides[2],
-            (uint8_t*)Buffer.data(), (int)fr.Width * 3, (int)fr.Width, (int)fr.Height);
+size_t Pxconv::fetchFrames(Videoframe *frames, size_t count)
+{
+    auto srcstats = Source->codecStats();
+    uint64_t dropped = srcstats ? srcstats->Dropped.load(std::memory_order_relaxed) : 0;
+    uint64_t skipped = srcstats ? srcstats->Skipped.load(std::memory_order_relaxed) : 0;
 
-        f.Linestrides[0] = 0;
-        f.Planes[0] = Buffer.data();
+    size_t n = Source->fetchFrames(frames, count);
+    if(srcstats)
+    {
+        Codecstats::add(Stats->Dropped, srcstats->Dropped.load(std::memory_order_relaxed) - dropped);
+        Codecstats::add(Stats->Skipped, srcstats->Skipped.load(std::memory_order_relaxed) - skipped);
     }
-    if(Format == Pixelformat::RGBA32I && fr.Format == Pixelformat::YUV12P)
+    if(n == 0)
+        return 0;
+
+    //each frame of a batch needs a buffer of its own
+    if(!Buffers && n > 1 && !Batchbuffers)
+        Batchbuffers = std::make_unique<Framepool>(std::max<size_t>(n, 8));
+    Framepool *pool = Buffers ? Buffers.get() : n > 1 ? Batchbuffers.get() : nullptr;
+
+    size_t threads = Pool ? Pool->size() : 1;
+    unsigned int maxheight = 0;
+    for(size_t i = 0; i < n; ++i)
+        maxheight = std::max(maxheight, frames[i].Height);
+    bool whole = threads > 1 && n > 1 && (n >= threads || maxheight < threads * Bandrows);
+
+    auto begin = std::chrono::steady_clock::now();
+    uint64_t bytes = 0;
+
+    //frames converted in one step go to the worker pool, scratch buffers serve one frame at a time
+    std::vector<Videoframe> views;
+    std::vector<std::future<void>> jobs;
+    std::exception_ptr error;
+    views.reserve(n);
+
+    try
     {
-        if(fr.Width * fr.Height * 4 > Buffer.size())
-            Buffer.resize(fr.Width * fr.Height * 4);
+        for(size_t i = 0; i < n; ++i)
+        {
+            Videoframe fr = std::move(frames[i]);
+            bytes += frameBytes(fr.Format, fr.Width, fr.Height);
 
-        libyuv::I420ToRGBA((uint8_t*)fr.Planes[0], (int)fr.Linestrides[0],
-            (uint8_t*)fr.Planes[1], (int)fr.Linestrides[1],
-            (uint8_t*)fr.Planes[2], (int)fr.Linestrides[2],
-            (uint8_t*)Buffer.data(), (int)fr.Width * 4, (int)fr.Width, (int)fr.Height);
+            auto view = cropFrame(fr);
+            bool scale = (Width && Width != view.Width) || (Height && Height != view.Height);
+            bool pass = Format == view.Format && !scale && !Flip;
 
-        f.Linestrides[0] = 0;
-        f.Planes[0] = Buffer.data();
+            if(!whole || scale || pass || route(view.Format, Format).Steps > 1)
+            {
+                convert(fr, frames[i], nullptr, 0, pool);
+                continue;
+            }
+
+            views.push_back(view);
+            auto dst = outputFrame(frames[i], view.Width, view.Height, nullptr, 0, pool);
+            jobs.push_back(Pool->post([this, src = &views.back(), dst]{ convertFrame(*src, dst, Flip, false); }));
+        }
     }
-    else if(Format == fr.Format)
+    catch(...)
     {
-        f = fr;
+        error = std::current_exception(); //posted jobs still refer to views
     }
-    else
+
+    for(auto &j : jobs)
     {
-        throw InfeasibleConversion();
+        try
+        {
+            j.get();
+        }
+        catch(...)
+        {
+            error = std::current_exception();
+        }
     }
+    if(error)
+        std::rethrow_exception(error);
 
-    return true;
+    auto elapsed = std::chrono::steady_clock::now() - begin;
+    for(size_t i = 0; i < n; ++i)
+        Stats->addDecodetime(elapsed / n);
+    Codecstats::add(Stats->Frames, n);
+    Codecstats::add(Stats->BytesConsumed, bytes);
+    return n;
+}
+
+void Pxconv::convert(const Videoframe &fr, Videoframe &f, void *dest, size_t stride, Framepool *pool)
+{
+    auto view = cropFrame(fr);
+    unsigned int width = Width ? Width : view.Width, height = Height ? Height : view.Height;
+    bool scale = width != view.Width || height != view.Height;
+
+    if(Format == view.Format && !scale && !Flip && !dest)
+    {
+        f = view;
+        if(Buffers && !f.Owner)
+            f = copyFrame(view, *Buffers);
+    }
+    else if(!scale)
+        convertFrame(view, outputFrame(f, width, height, dest, stride, pool), Flip);
+    else
+    {
+        //scale before converting if possible, so conversions run on the smaller frame
+        auto fmt = scalableFormat(view.Format, Format);
+        if(fmt != view.Format)
+        {
+            auto pre = scratchFrame(0, fmt, view.Width, view.Height);
+            convertFrame(view, pre, false);
+            view = pre;
+        }
+
+        if(fmt == Format)
+            scaleFrame(view, outputFrame(f, width, height, dest, stride, pool), Flip);
+        else
+        {
+            auto scaled = scratchFrame(1, fmt, width, height);
+            scaleFrame(view, scaled, false);
+            convertFrame(scaled, outputFrame(f, width, height, dest, stride, pool), Flip);
+        }
+    }
 }
 
 std::unique_ptr<ISourceSeek> Pxconv::tellFrame() const
@@ -77,4 +729,14 @@ void Pxconv::seekFrame(const ISourceSeek &s)
     Source->seekFrame(s);
 }
 
+const Codecstats *Pxconv::codecStats() const
+{
+    return Stats.get();
+}
+
+bool Pxconv::codecSkip(Frameskip mode)
+{
+    return Source->codecSkip(mode);
+}
+
 }
\ No newline at end of file
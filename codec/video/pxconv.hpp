@@ -1,6 +1,8 @@
 #pragma once
 
 #include <vector>
+#include <memory>
+#include <functional>
 #include <stdexcept>
 
 #include "codec.hpp"
@@ -11,24 +13,84 @@ namespace mlib::codec::video
 //
 // converts between pixel formats
 //
+// Converts along the cheapest path of libyuv and repacking conversions between the formats.
+//
+// With a frame pool, converted frames are written to pooled buffers, unconverted frames
+// not owned by the source are copied to them.
+//
+// Parameters:
+// - "convthreads" (default 1) converts frames in horizontal bands aligned to chroma rows
+//   on a worker pool of this many threads (0 selects hardware threads).
+// - "crop" ("x,y,w,h", default 0,0,0,0 for none) crops frames, x and y rounded down to even.
+// - "size" ("wxh", default 0x0 for the cropped size) scales frames. Scaling happens before
+//   converting where the source format allows, so conversions touch only the target size.
+// - "flip" (0 or 1) flips frames vertically while writing them.
+//
+// fetchFrameInto writes the frame to caller-owned memory at dest instead, laid out as by
+// layoutFrame with the given stride. f receives the frame referring to dest.
+//
+// fetchFrames converts a batch fetched by the source's fetchFrames. Without a frame pool, its frames
+// are written to buffers of a pool of their own, so that all of them stay valid. With convthreads,
+// batches of at least as many frames as threads, or of frames too low to be split into bands of
+// Bandrows rows, convert each frame in one piece on the worker pool, all frames at once.
+//
+// codecStats counts converted frames and the source frames' pixel bytes, decode times are those
+// of converting only. Frames dropped or skipped by the source are counted alike, its other statistics
+// are those of its codecStats. codecSkip is passed to the source.
+//
+
+class Workerpool;
 
 class Pxconv : public IVideoDecodec
 {
 public:
     Pxconv(IVideoDecodec &source, Pixelformat destfmt);
+    ~Pxconv();
 
     void codecLogging(CodecLoglevel, CodecLogger) override;
     void codecParameter(const std::string &parameter, const std::string &value) override;
 
     bool fetchFrame(Videoframe&) override;
+    bool fetchFrameInto(Videoframe &f, void *dest, size_t stride);
+    size_t fetchFrames(Videoframe *frames, size_t count) override;
 
     std::unique_ptr<ISourceSeek> tellFrame() const override;
     void seekFrame(const ISourceSeek&) override;
 
+    void codecFramepool(std::shared_ptr<Framepool>) override;
+    const Codecstats *codecStats() const override;
+    bool codecSkip(Frameskip mode) override;
+
 private:
+    struct Croprect
+    {
+        unsigned int X = 0, Y = 0, Width = 0, Height = 0;
+    };
+
+    static constexpr size_t Scratchsteps = 2; //scratch slots before those of conversion steps
+    static constexpr unsigned int Bandrows = 64; //least rows per band worth a thread
+
+    char *outputBuffer(Videoframe &f, size_t bytes, Framepool *pool);
+    bool fetch(Videoframe &f, void *dest, size_t stride);
+    void convert(const Videoframe &fr, Videoframe &f, void *dest, size_t stride, Framepool *pool);
+    Videoframe outputFrame(Videoframe &f, unsigned int width, unsigned int height, void *dest, size_t stride, Framepool *pool);
+    Videoframe scratchFrame(size_t slot, Pixelformat fmt, unsigned int width, unsigned int height);
+    Videoframe cropFrame(const Videoframe &f) const;
+    void convertFrame(const Videoframe &src, const Videoframe &dst, bool flip, bool banded = true);
+    void convertBands(unsigned height, const std::function<void(unsigned, unsigned)> &convert, bool banded);
+
     IVideoDecodec *Source;
     Pixelformat Format;
     std::vector<char> Buffer;
+    std::vector<std::vector<char>> Scratch;
+    std::shared_ptr<Framepool> Buffers;
+    std::unique_ptr<Framepool> Batchbuffers;
+    std::unique_ptr<Workerpool> Pool;
+    std::unique_ptr<Codecstats> Stats;
+
+    unsigned int Width = 0, Height = 0;
+    Croprect Crop;
+    bool Flip = false;
 };
 
 //
@@ -40,4 +102,4 @@ struct InfeasibleConversion : public std::runtime_error
     InfeasibleConversion() : runtime_error("animutil.videoplayer.infconv") {}
 };
 
-}
\ No newline at end of file
+}
\ No newline at end of file
@@ -0,0 +1,71 @@
+#include "registry.hpp"
+#include "h264/poolh264.hpp"
+#include "piq/decodepiq.hpp"
+
+#include <utility>
+
+namespace mlib::codec::video
+{
+
+static bool sniffPiq(const unsigned char *p, size_t len)
+{
+    return len >= 5 && p[0] == 'P' && p[1] == 'I' && p[2] == 'Q' && p[3] == '!' && (p[4] == 1 || p[4] == 2);
+}
+
+//leading zero bytes may precede the first start code, the NAL unit's forbidden bit is 0
+static bool sniffAnnexB(const unsigned char *p, size_t len)
+{
+    size_t zeros = 0;
+    while(zeros < len && p[zeros] == 0)
+        ++zeros;
+
+    return zeros >= 2 && zeros + 1 < len && p[zeros] == 1 && (p[zeros + 1] & 0x80) == 0;
+}
+
+Registry::Registry(size_t maxidle) : H264(std::make_unique<h264::Decoderpool>(maxidle))
+{
+    registerFormat("piq", 5, sniffPiq, [](ICodecSourcebuffer &src, const Parameters &params) {
+        return std::make_unique<piq::Decoder>(src, params);
+    });
+
+    auto pool = H264.get();
+    registerFormat("h264", 32, sniffAnnexB, [pool](ICodecSourcebuffer &src, const Parameters &params) {
+        return pool->createDecoder(src, params);
+    });
+}
+
+Registry::~Registry() = default;
+
+void Registry::registerFormat(const std::string &name, size_t sniffbytes, Sniffer sniff, Factory create)
+{
+    Formats.push_back({ name, sniffbytes, std::move(sniff), std::move(create) });
+}
+
+const Registry::Format *Registry::sniff(ICodecSourcebuffer &source) const
+{
+    for(const auto &f : Formats)
+    {
+        auto[ptr, len] = source.minimalBuffer(f.Sniffbytes);
+        if(f.Sniff(static_cast<const unsigned char*>(ptr), std::min(len, f.Sniffbytes)))
+            return &f;
+    }
+
+    return nullptr;
+}
+
+std::string Registry::sniffFormat(ICodecSourcebuffer &source) const
+{
+    auto f = sniff(source);
+    return f ? f->Name : std::string();
+}
+
+std::unique_ptr<IVideoDecodec> Registry::openDecoder(ICodecSourcebuffer &source, const Parameters &parameters) const
+{
+    auto f = sniff(source);
+    if(!f)
+        throw UnknownFormat();
+
+    return f->Create(source, parameters);
+}
+
+}
@@ -0,0 +1,77 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <functional>
+
+#include "codec.hpp"
+
+namespace mlib::codec::video
+{
+
+namespace h264
+{
+class Decoderpool;
+}
+
+//
+// exceptions
+//
+
+struct UnknownFormat : public CodecError
+{
+    UnknownFormat() : CodecError(".unknownformat") {}
+};
+
+//
+// codec registry
+//
+// Creates decoders for sources by sniffing their first bytes. Formats are tried in the order
+// they were registered, each given up to sniffbytes bytes from the beginning of the source's buffer,
+// which is extended as needed but not advanced.
+// Registered on construction:
+// - "piq": 'PIQ!' signature and version 1 or 2, see piq::Decoder
+// - "h264": AnnexB start code followed by a NAL unit header, decoders are taken from
+//   a Decoderpool keeping up to maxidle openh264 instances, see h264::Decoderpool
+//
+// - registerFormat adds a format.
+// - sniffFormat returns the name of a source's format, or an empty string if no format matches.
+// - openDecoder creates a decoder for a source, passing it the parameters.
+//   Throws UnknownFormat if no format matches.
+// Registering is not thread-safe, sniffing and opening are.
+//
+
+class Registry
+{
+public:
+    using Parameters = std::vector<std::pair<std::string, std::string>>;
+    using Sniffer = std::function<bool(const unsigned char *data, size_t len)>;
+    using Factory = std::function<std::unique_ptr<IVideoDecodec>(ICodecSourcebuffer &source, const Parameters &parameters)>;
+
+    Registry(size_t maxidle = 8);
+    ~Registry();
+
+    void registerFormat(const std::string &name, size_t sniffbytes, Sniffer sniff, Factory create);
+
+    std::string sniffFormat(ICodecSourcebuffer &source) const;
+    std::unique_ptr<IVideoDecodec> openDecoder(ICodecSourcebuffer &source, const Parameters &parameters = {}) const;
+
+    h264::Decoderpool &h264Decoders() { return *H264; }
+
+private:
+    struct Format
+    {
+        std::string Name;
+        size_t Sniffbytes;
+        Sniffer Sniff;
+        Factory Create;
+    };
+
+    const Format *sniff(ICodecSourcebuffer &source) const;
+
+    std::vector<Format> Formats;
+    std::unique_ptr<h264::Decoderpool> H264;
+};
+
+}
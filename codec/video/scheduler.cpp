@@ -0,0 +1,157 @@
+#include "scheduler.hpp"
+#include "codecstats.hpp"
+#include "framepool.hpp"
+
+#include <utility>
+#include <algorithm>
+
+namespace mlib::codec::video
+{
+
+Scheduler::Scheduler(IVideoDecodec &source, double framerate, size_t depth) : Source(&source), Depth(depth)
+{
+    if(!(framerate > 0))
+        throw GenericCodecError<WrongParameter>("scheduler", "framerate");
+    if(depth == 0)
+        throw GenericCodecError<WrongParameter>("scheduler", "depth");
+
+    Interval = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(1 / framerate));
+    Buffers = std::make_shared<Framepool>(depth + 2);
+    Started = Ended = Stopping = false;
+
+    Worker = std::thread(&Scheduler::work, this);
+}
+
+Scheduler::~Scheduler()
+{
+    {
+        std::lock_guard<std::mutex> l(Lock);
+        Stopping = true;
+    }
+    Consumed.notify_all();
+    Worker.join();
+}
+
+Scheduler::Clock::time_point Scheduler::due(uint64_t index) const
+{
+    return Origin + Interval * static_cast<int64_t>(index);
+}
+
+void Scheduler::work()
+{
+    try
+    {
+        const Codecstats *srcstats = Source->codecStats();
+        uint64_t next = 0;
+
+        for(;;)
+        {
+            Frameskip skip = Frameskip::None;
+            {
+                std::unique_lock<std::mutex> l(Lock);
+                Consumed.wait(l, [&]() { return Stopping || Queue.size() < Depth; });
+                if(Stopping)
+                    return;
+
+                if(Started)
+                {
+                    auto lag = Clock::now() - due(next);
+                    if(lag > Interval * static_cast<int64_t>(Depth))
+                        skip = Frameskip::Keyframe;
+                    else if(lag > Interval)
+                        skip = Frameskip::Nonreference;
+                }
+            }
+
+            Source->codecSkip(skip);
+            uint64_t skipped = srcstats ? srcstats->Skipped.load(std::memory_order_relaxed) : 0;
+            uint64_t dropped = srcstats ? srcstats->Dropped.load(std::memory_order_relaxed) : 0;
+
+            Videoframe fr;
+            bool success = Source->fetchFrame(fr);
+            if(srcstats)
+            {
+                skipped = srcstats->Skipped.load(std::memory_order_relaxed) - skipped;
+                dropped = srcstats->Dropped.load(std::memory_order_relaxed) - dropped;
+            }
+
+            if(success && !fr.Owner)
+                fr = copyFrame(fr, *Buffers);
+
+            std::lock_guard<std::mutex> l(Lock);
+            next += skipped + dropped; //missing pictures keep their place in time
+            Stats.Skipped.fetch_add(skipped, std::memory_order_relaxed);
+
+            if(success)
+            {
+                Queue.push_back({ std::move(fr), next++ });
+                Stats.Queued.store(Queue.size(), std::memory_order_relaxed);
+            }
+            else
+                Ended = true;
+
+            Produced.notify_all();
+            if(!success)
+                return;
+        }
+    }
+    catch(...)
+    {
+        std::lock_guard<std::mutex> l(Lock);
+        Error = std::current_exception();
+        Produced.notify_all();
+    }
+}
+
+bool Scheduler::nextFrame(Videoframe &f)
+{
+    Clock::time_point when;
+    {
+        std::unique_lock<std::mutex> l(Lock);
+        if(!Started)
+        {
+            Origin = Clock::now();
+            Started = true;
+        }
+
+        for(;;)
+        {
+            Produced.wait(l, [&]() { return !Queue.empty() || Ended || Error; });
+            if(Queue.empty())
+            {
+                if(Error)
+                    std::rethrow_exception(Error);
+                return false;
+            }
+
+            auto e = std::move(Queue.front());
+            Queue.pop_front();
+            Stats.Queued.store(Queue.size(), std::memory_order_relaxed);
+            Consumed.notify_all();
+
+            //a late frame is dropped if the following one is due as well
+            auto now = Clock::now();
+            if(!Queue.empty() && due(Queue.front().Index) <= now)
+            {
+                Stats.Dropped.fetch_add(1, std::memory_order_relaxed);
+                continue;
+            }
+
+            f = std::move(e.Frame);
+            when = due(e.Index);
+            break;
+        }
+    }
+
+    std::this_thread::sleep_until(when);
+
+    auto jitter = static_cast<uint64_t>(std::max<int64_t>(0, std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - when).count()));
+    Stats.JitterNanoseconds.fetch_add(jitter, std::memory_order_relaxed);
+    if(jitter > Stats.MaxJitterNanoseconds.load(std::memory_order_relaxed))
+        Stats.MaxJitterNanoseconds.store(jitter, std::memory_order_relaxed);
+    Stats.Presented.fetch_add(1, std::memory_order_relaxed);
+
+    return true;
+}
+
+}
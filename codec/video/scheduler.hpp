@@ -0,0 +1,99 @@
+#pragma once
+
+#include <deque>
+#include <memory>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <exception>
+#include <cstdint>
+
+#include "codec.hpp"
+
+namespace mlib::codec::video
+{
+
+//
+// playback statistics
+//
+// Updated by the scheduler, readable from any thread without locking.
+// - Presented: frames returned by nextFrame
+// - Dropped: decoded frames discarded because a later frame was already due
+// - Skipped: frames the source skipped without decoding them, see IVideoDecodec::codecSkip
+// - JitterNanoseconds, MaxJitterNanoseconds: total and largest delay of returning frames after they were due
+// - Queued: frames currently decoded ahead
+//
+
+struct Playbackstats
+{
+    std::atomic<uint64_t> Presented{ 0 }, Dropped{ 0 }, Skipped{ 0 };
+    std::atomic<uint64_t> JitterNanoseconds{ 0 }, MaxJitterNanoseconds{ 0 };
+    std::atomic<size_t> Queued{ 0 };
+};
+
+class Framepool;
+
+//
+// playback scheduler
+//
+// Paces the frames of a decoder at a frame rate against a monotonic clock, which starts with the
+// first call to nextFrame, when the first frame is due. A worker thread decodes up to depth frames
+// ahead into owned buffers, so returned frames stay valid as long as they are referenced.
+// - nextFrame waits until the next frame is due and returns it. Frames which are late while a
+//   later frame is due as well are dropped. Returns false at the end of the stream.
+//
+// When decoding lags behind more than one frame interval, the worker makes the source skip
+// non-reference frames, when it lags behind more than depth frame intervals, it makes the source
+// skip to the next keyframe (see IVideoDecodec::codecSkip). Frames skipped by the source,
+// as counted by its codecStats, advance the clock like decoded ones, as do frames it failed to decode.
+// Sources without codecSkip never skip, the clock of sources without codecStats only advances
+// with the frames they return.
+// The source must not be used directly while it is scheduled.
+//
+
+class Scheduler
+{
+public:
+    Scheduler(IVideoDecodec &source, double framerate, size_t depth = 4);
+    ~Scheduler();
+
+    bool nextFrame(Videoframe &f);
+
+    const Playbackstats &stats() const { return Stats; }
+
+    Scheduler(Scheduler&&) = delete;
+    Scheduler(const Scheduler&) = delete;
+    Scheduler &operator=(Scheduler&&) = delete;
+    Scheduler &operator=(const Scheduler&) = delete;
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    struct Entry
+    {
+        Videoframe Frame;
+        uint64_t Index;
+    };
+
+    void work();
+    Clock::time_point due(uint64_t index) const;
+
+    IVideoDecodec *Source;
+    std::shared_ptr<Framepool> Buffers;
+    Clock::duration Interval;
+    size_t Depth;
+
+    std::deque<Entry> Queue;
+    Clock::time_point Origin;
+    bool Started, Ended, Stopping;
+    std::exception_ptr Error;
+    Playbackstats Stats;
+
+    std::mutex Lock;
+    std::condition_variable Produced, Consumed;
+    std::thread Worker;
+};
+
+}
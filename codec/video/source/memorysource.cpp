@@ -11,7 +11,8 @@ struct S : public ISourceSeek
     size_t Length;
 };
 
-MemorySource::MemorySource(const void *begin, size_t length) : Begin(static_cast<const char*>(begin)), Length(length)
+MemorySource::MemorySource(const void *begin, size_t length)
+    : Origin(static_cast<const char*>(begin)), Begin(static_cast<const char*>(begin)), Total(length), Length(length)
 {
 }
 
@@ -45,4 +46,18 @@ void MemorySource::sourceSeek(const ISourceSeek &s)
     Length = k.Length;
 }
 
+
+uint64_t MemorySource::sourceOffset() const
+{
+    return static_cast<uint64_t>(Begin - Origin);
+}
+void MemorySource::sourceSeekOffset(uint64_t offset)
+{
+    if(offset > Total)
+        throw GenericCodecError<StreamUnexpectedEnd>("memorysource", "seek offset");
+
+    Begin = Origin + offset;
+    Length = Total - static_cast<size_t>(offset);
+}
+
 }
\ No newline at end of file
@@ -21,9 +21,12 @@ public:
     std::unique_ptr<ISourceSeek> sourceTell() const override;
     void sourceSeek(const ISourceSeek &) override;
 
+    uint64_t sourceOffset() const override;
+    void sourceSeekOffset(uint64_t offset) override;
+
 private:
-    const char *Begin;
-    size_t Length;
+    const char *Origin, *Begin;
+    size_t Total, Length;
 };
 
 }
\ No newline at end of file
@@ -0,0 +1,235 @@
+#include "mmapsource.hpp"
+
+#include <mlib/platform.hpp>
+#include <mlib/error/nativeerror.hpp>
+
+#ifdef MLIB_PLATFORM_WIN32
+#include <Windows.h>
+#include <mlib/unicode/unicodecvt.hpp>
+#else
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <cerrno>
+#endif
+
+#include <algorithm>
+#include <cassert>
+
+namespace mlib::codec::video::mmapsource
+{
+
+struct S : public ISourceSeek
+{
+    uint64_t Begin;
+    size_t Length;
+};
+
+//
+// platform specific mapping
+//
+
+#ifdef MLIB_PLATFORM_WIN32
+
+static void unmap(const char *mapping, void *file, void *map)
+{
+    if(mapping)
+        UnmapViewOfFile(mapping);
+    if(map)
+        CloseHandle(map);
+    if(file != INVALID_HANDLE_VALUE)
+        CloseHandle(file);
+}
+
+static size_t pageSize()
+{
+    SYSTEM_INFO inf;
+    GetSystemInfo(&inf);
+    return inf.dwAllocationGranularity;
+}
+
+#else
+
+static void unmap(const char *mapping, uint64_t size, int file)
+{
+    if(mapping)
+        munmap(const_cast<char*>(mapping), static_cast<size_t>(size));
+    if(file >= 0)
+        close(file);
+}
+
+static size_t pageSize()
+{
+    return static_cast<size_t>(sysconf(_SC_PAGESIZE));
+}
+
+#endif
+
+//
+// source
+//
+
+MmapSource::MmapSource(const std::string &path, size_t readahead)
+    : Mapping(nullptr), Size(0), Begin(0), Length(0), Readahead(readahead), Advised(0), Released(0)
+{
+#ifdef MLIB_PLATFORM_WIN32
+    MappingHandle = nullptr;
+    FileHandle = CreateFileW(unicode::toNative(path).c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if(FileHandle == INVALID_HANDLE_VALUE)
+        throw OpenError(path, error::formatError(GetLastError()));
+
+    LARGE_INTEGER siz;
+    if(!GetFileSizeEx(FileHandle, &siz))
+    {
+        auto e = GetLastError();
+        unmap(nullptr, FileHandle, nullptr);
+        throw OpenError(path, error::formatError(e));
+    }
+    Size = static_cast<uint64_t>(siz.QuadPart);
+
+    if(Size > 0)
+    {
+        MappingHandle = CreateFileMappingW(FileHandle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        if(MappingHandle)
+            Mapping = static_cast<const char*>(MapViewOfFile(MappingHandle, FILE_MAP_READ, 0, 0, 0));
+
+        if(!Mapping)
+        {
+            auto e = GetLastError();
+            unmap(nullptr, FileHandle, MappingHandle);
+            throw OpenError(path, error::formatError(e));
+        }
+    }
+#else
+    File = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if(File < 0)
+        throw OpenError(path, error::formatError(errno));
+
+    struct stat st;
+    if(fstat(File, &st) != 0)
+    {
+        auto e = errno;
+        unmap(nullptr, 0, File);
+        throw OpenError(path, error::formatError(e));
+    }
+    Size = static_cast<uint64_t>(st.st_size);
+
+    if(Size > 0)
+    {
+        void *m = mmap(nullptr, static_cast<size_t>(Size), PROT_READ, MAP_PRIVATE, File, 0);
+        if(m == MAP_FAILED)
+        {
+            auto e = errno;
+            unmap(nullptr, 0, File);
+            throw OpenError(path, error::formatError(e));
+        }
+
+        Mapping = static_cast<const char*>(m);
+        madvise(m, static_cast<size_t>(Size), MADV_SEQUENTIAL);
+    }
+#endif
+}
+
+MmapSource::~MmapSource()
+{
+#ifdef MLIB_PLATFORM_WIN32
+    unmap(Mapping, FileHandle, MappingHandle);
+#else
+    unmap(Mapping, Size, File);
+#endif
+}
+
+void MmapSource::advise()
+{
+#ifndef MLIB_PLATFORM_WIN32
+    if(!Mapping)
+        return;
+
+    const uint64_t page = pageSize();
+    const uint64_t end = Begin + Length;
+
+    if(end + Readahead / 2 > Advised && Advised < Size) //prefetch pages in front of the window
+    {
+        uint64_t from = std::max(Advised, end) / page * page;
+        uint64_t to = std::min<uint64_t>(Size, end + Readahead);
+        if(to > from)
+            madvise(const_cast<char*>(Mapping) + from, static_cast<size_t>(to - from), MADV_WILLNEED);
+        Advised = to;
+    }
+
+    uint64_t behind = Begin / page * page;
+    if(behind >= Released + Readahead) //release pages behind the window
+    {
+        madvise(const_cast<char*>(Mapping) + Released, static_cast<size_t>(behind - Released), MADV_DONTNEED);
+        Released = behind;
+    }
+#endif
+}
+
+std::pair<const void*, size_t> MmapSource::extendBuffer(size_t length)
+{
+    auto nread = static_cast<size_t>(std::min<uint64_t>(length, Size - (Begin + Length)));
+    Length += nread;
+    advise();
+
+    return { Mapping + Begin, nread };
+}
+
+std::pair<const void*, size_t> MmapSource::advanceBuffer(size_t amount)
+{
+    assert(amount <= Length);
+
+    Begin += amount;
+    Length -= amount;
+
+    auto nread = static_cast<size_t>(std::min<uint64_t>(amount, Size - (Begin + Length)));
+    Length += nread;
+    advise();
+
+    return { Mapping + Begin, nread };
+}
+
+std::pair<const void*, size_t> MmapSource::bufferProperties() const
+{
+    return { Mapping + Begin, Length };
+}
+
+std::unique_ptr<ISourceSeek> MmapSource::sourceTell() const
+{
+    auto s = std::make_unique<S>();
+    s->Begin = Begin;
+    s->Length = Length;
+    return s;
+}
+
+void MmapSource::sourceSeek(const ISourceSeek &s)
+{
+    const auto &k = static_cast<const S&>(s);
+    Begin = k.Begin;
+    Length = k.Length;
+
+    const uint64_t page = pageSize();
+    Released = std::min(Released, Begin / page * page);
+    Advised = std::min(Advised, Begin / page * page);
+    advise();
+}
+
+uint64_t MmapSource::sourceOffset() const
+{
+    return Begin;
+}
+
+void MmapSource::sourceSeekOffset(uint64_t offset)
+{
+    if(offset > Size)
+        throw GenericCodecError<StreamUnexpectedEnd>("mmapsource", "seek offset");
+
+    S k;
+    k.Begin = offset;
+    k.Length = 0;
+    sourceSeek(k);
+}
+
+}
\ No newline at end of file
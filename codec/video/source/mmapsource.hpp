@@ -0,0 +1,73 @@
+#pragma once
+
+#include <string>
+#include <cstdint>
+#include <mlib/platform.hpp>
+
+#include "../codec.hpp"
+
+namespace mlib::codec::video::mmapsource
+{
+
+//
+// exceptions
+//
+
+struct MapError : public CodecError
+{
+    MapError(const std::string &e) : CodecError(".mmapsource" + e) {}
+};
+
+struct OpenError : public MapError
+{
+    OpenError(const std::string &path, const std::string &msg) : MapError(".open (" + path + ") (" + msg + ")") {}
+};
+
+//
+// memory-mapped file sourcebuffer
+//
+// Maps a whole file and moves the buffer as a window over the mapping without copying.
+// Pages up to readahead bytes in front of the window are prefetched,
+// pages behind the window are released, so resident memory stays bounded.
+//
+
+class MmapSource : public ICodecSourcebuffer
+{
+public:
+    MmapSource(const std::string &path, size_t readahead = 4 * 1024 * 1024);
+    ~MmapSource();
+
+    std::pair<const void*, size_t> extendBuffer(size_t length) override;
+    std::pair<const void*, size_t> advanceBuffer(size_t amount) override;
+    std::pair<const void*, size_t> bufferProperties() const override;
+
+    std::unique_ptr<ISourceSeek> sourceTell() const override;
+    void sourceSeek(const ISourceSeek &) override;
+
+    uint64_t sourceOffset() const override;
+    void sourceSeekOffset(uint64_t offset) override;
+
+    MmapSource(MmapSource&&) = delete;
+    MmapSource(const MmapSource&) = delete;
+    MmapSource &operator=(MmapSource&&) = delete;
+    MmapSource &operator=(const MmapSource&) = delete;
+
+private:
+    void advise();
+
+    const char *Mapping;
+    uint64_t Size;
+    uint64_t Begin;
+    size_t Length;
+
+    size_t Readahead;
+    uint64_t Advised, Released;
+
+#ifdef MLIB_PLATFORM_WIN32
+    void *FileHandle, *MappingHandle;
+#else
+    int File;
+#endif
+};
+
+}
@@ -0,0 +1,435 @@
+#include "prefetchsource.hpp"
+
+#include <mlib/error/nativeerror.hpp>
+
+#ifdef MLIB_PLATFORM_WIN32
+#include <Windows.h>
+#include <mlib/unicode/unicodecvt.hpp>
+#else
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <cerrno>
+#endif
+
+#if defined MLIB_PLATFORM_LINUX && defined __has_include
+    #if __has_include(<liburing.h>)
+        #include <liburing.h>
+        #define MLIB_PREFETCH_IOURING
+    #endif
+#endif
+
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+#include <algorithm>
+#include <cassert>
+
+namespace mlib::codec::video::prefetchsource
+{
+
+struct S : public ISourceSeek
+{
+    uint64_t Position;
+};
+
+//
+// positional read
+// Returns number of bytes read, 0 at end of file or a negative error code.
+//
+
+#ifdef MLIB_PLATFORM_WIN32
+
+static long long readAt(void *file, void *dest, size_t len, uint64_t offset)
+{
+    OVERLAPPED ov = { 0 };
+    ov.Offset = static_cast<DWORD>(offset);
+    ov.OffsetHigh = static_cast<DWORD>(offset >> 32);
+
+    DWORD nread;
+    if(!ReadFile(file, dest, static_cast<DWORD>(std::min<size_t>(len, 1u << 30)), &nread, &ov))
+    {
+        auto e = GetLastError();
+        return e == ERROR_HANDLE_EOF ? 0 : -static_cast<long long>(e);
+    }
+    return nread;
+}
+
+#else
+
+static long long readAt(int file, void *dest, size_t len, uint64_t offset)
+{
+    for(;;)
+    {
+        auto n = pread(file, dest, len, static_cast<off_t>(offset));
+        if(n >= 0)
+            return n;
+        if(errno != EINTR)
+            return -static_cast<long long>(errno);
+    }
+}
+
+#endif
+
+//
+// read backends
+// submit issues the read of a chunk's missing bytes, ready and wait report its completion.
+//
+
+struct PrefetchSource::Reader
+{
+    virtual ~Reader() = default;
+
+    virtual void submit(Chunk &c) = 0;
+    virtual bool ready(Chunk &c) = 0;
+    virtual void wait(Chunk &c) = 0;
+};
+
+struct PrefetchSource::ThreadReader : public PrefetchSource::Reader
+{
+    PrefetchSource *Owner;
+    std::deque<Chunk*> Queue;
+    bool Stopping;
+
+    std::mutex Lock;
+    std::condition_variable Wakeup, Completed;
+    std::thread Worker;
+
+    ThreadReader(PrefetchSource &owner) : Owner(&owner), Stopping(false)
+    {
+        Worker = std::thread(&ThreadReader::work, this);
+    }
+    ~ThreadReader()
+    {
+        {
+            std::lock_guard<std::mutex> l(Lock);
+            Stopping = true;
+        }
+        Wakeup.notify_all();
+        Worker.join();
+    }
+
+    void submit(Chunk &c) override
+    {
+        {
+            std::lock_guard<std::mutex> l(Lock);
+            Queue.push_back(&c);
+        }
+        Wakeup.notify_one();
+    }
+    bool ready(Chunk &c) override
+    {
+        std::lock_guard<std::mutex> l(Lock);
+        return c.Done;
+    }
+    void wait(Chunk &c) override
+    {
+        std::unique_lock<std::mutex> l(Lock);
+        Completed.wait(l, [&]() { return c.Done; });
+    }
+
+    void work()
+    {
+        for(;;)
+        {
+            Chunk *c;
+            {
+                std::unique_lock<std::mutex> l(Lock);
+                Wakeup.wait(l, [&]() { return Stopping || !Queue.empty(); });
+                if(Stopping)
+                    return;
+
+                c = Queue.front();
+                Queue.pop_front();
+            }
+
+            size_t filled = c->Filled; //the chunk is not touched by the consumer until it is done
+            int error = 0;
+            while(filled < c->Expected)
+            {
+                auto n = readAt(Owner->File, c->Data.data() + filled, c->Expected - filled, c->Offset + filled);
+                if(n <= 0)
+                {
+                    error = static_cast<int>(-n);
+                    break;
+                }
+                filled += static_cast<size_t>(n);
+            }
+
+            {
+                std::lock_guard<std::mutex> l(Lock);
+                c->Filled = filled;
+                c->Error = error;
+                c->Done = true;
+            }
+            Completed.notify_all();
+        }
+    }
+};
+
+#ifdef MLIB_PREFETCH_IOURING
+
+struct PrefetchSource::UringReader : public PrefetchSource::Reader
+{
+    io_uring Ring;
+    int File;
+
+    static std::unique_ptr<UringReader> create(int file, size_t depth)
+    {
+        auto r = std::make_unique<UringReader>();
+        r->File = file;
+        if(io_uring_queue_init(static_cast<unsigned int>(depth), &r->Ring, 0) < 0) //not supported or not permitted
+            return nullptr;
+        return r;
+    }
+    ~UringReader()
+    {
+        io_uring_queue_exit(&Ring);
+    }
+
+    void submit(Chunk &c) override
+    {
+        io_uring_sqe *sqe = io_uring_get_sqe(&Ring); //never exhausted, at most depth chunks are in flight
+        assert(sqe);
+        io_uring_prep_read(sqe, File, c.Data.data() + c.Filled, static_cast<unsigned int>(c.Expected - c.Filled), c.Offset + c.Filled);
+        io_uring_sqe_set_data(sqe, &c);
+
+        if(int e = io_uring_submit(&Ring); e < 0)
+            throw ReadError(error::formatError(-e));
+    }
+    bool ready(Chunk &c) override
+    {
+        io_uring_cqe *cqe;
+        while(!c.Done && io_uring_peek_cqe(&Ring, &cqe) == 0)
+            reap(cqe);
+        return c.Done;
+    }
+    void wait(Chunk &c) override
+    {
+        while(!c.Done)
+        {
+            io_uring_cqe *cqe;
+            if(int e = io_uring_wait_cqe(&Ring, &cqe); e < 0)
+            {
+                if(e == -EINTR)
+                    continue;
+                throw ReadError(error::formatError(-e));
+            }
+            reap(cqe);
+        }
+    }
+
+    void reap(io_uring_cqe *cqe)
+    {
+        auto &c = *static_cast<Chunk*>(io_uring_cqe_get_data(cqe));
+        int res = cqe->res;
+        io_uring_cqe_seen(&Ring, cqe);
+
+        if(res < 0)
+        {
+            c.Error = -res;
+            c.Done = true;
+        }
+        else if(res == 0)
+            c.Done = true;
+        else
+        {
+            c.Filled += static_cast<size_t>(res);
+            if(c.Filled == c.Expected)
+                c.Done = true;
+            else
+                submit(c); //short read: request the remainder
+        }
+    }
+};
+
+#endif
+
+//
+// source
+//
+
+PrefetchSource::PrefetchSource(const std::string &path, size_t chunksize, size_t depth)
+    : Chunksize(chunksize), Current(0), NextOffset(0), Begin(0), Position(0), Misses(0), Stalled(0)
+{
+    if(chunksize == 0 || depth == 0)
+        throw OpenError(path, "invalid chunk configuration");
+
+#ifdef MLIB_PLATFORM_WIN32
+    File = CreateFileW(unicode::toNative(path).c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if(File == INVALID_HANDLE_VALUE)
+        throw OpenError(path, error::formatError(GetLastError()));
+
+    LARGE_INTEGER siz;
+    if(!GetFileSizeEx(File, &siz))
+    {
+        auto e = GetLastError();
+        CloseHandle(File);
+        throw OpenError(path, error::formatError(e));
+    }
+    Filesize = static_cast<uint64_t>(siz.QuadPart);
+#else
+    File = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if(File < 0)
+        throw OpenError(path, error::formatError(errno));
+
+    struct stat st;
+    if(fstat(File, &st) != 0)
+    {
+        auto e = errno;
+        close(File);
+        throw OpenError(path, error::formatError(e));
+    }
+    Filesize = static_cast<uint64_t>(st.st_size);
+#endif
+
+    Chunks.resize(depth);
+    for(auto &c : Chunks)
+    {
+        c.Data.resize(chunksize);
+        c.Done = true;
+    }
+
+#ifdef MLIB_PREFETCH_IOURING
+    Backend = UringReader::create(File, depth);
+#endif
+    if(!Backend)
+        Backend = std::make_unique<ThreadReader>(*this);
+
+    restart(0);
+}
+
+PrefetchSource::~PrefetchSource()
+{
+    for(auto &c : Chunks) //reads must not outlive the chunks
+        Backend->wait(c);
+    Backend.reset();
+
+#ifdef MLIB_PLATFORM_WIN32
+    CloseHandle(File);
+#else
+    close(File);
+#endif
+}
+
+void PrefetchSource::schedule(Chunk &c)
+{
+    c.Offset = NextOffset;
+    c.Expected = static_cast<size_t>(std::min<uint64_t>(Chunksize, Filesize - std::min(Filesize, NextOffset)));
+    c.Filled = c.Consumed = 0;
+    c.Error = 0;
+    c.Done = c.Expected == 0;
+    NextOffset += c.Expected;
+
+    if(!c.Done)
+        Backend->submit(c);
+}
+
+void PrefetchSource::restart(uint64_t offset)
+{
+    for(auto &c : Chunks)
+        Backend->wait(c);
+
+    NextOffset = offset;
+    Current = 0;
+    for(auto &c : Chunks)
+        schedule(c);
+}
+
+size_t PrefetchSource::read(size_t amount)
+{
+    if(Begin > 0 && Begin >= Buffer.size() - Begin) //keep the buffer compact, amortized over the advanced bytes
+    {
+        Buffer.erase(Buffer.begin(), Buffer.begin() + Begin);
+        Begin = 0;
+    }
+
+    size_t total = 0;
+    while(total < amount)
+    {
+        auto &c = Chunks[Current];
+        if(!Backend->ready(c))
+        {
+            Misses.fetch_add(1, std::memory_order_relaxed);
+            auto t0 = std::chrono::steady_clock::now();
+            Backend->wait(c);
+            auto dt = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - t0);
+            Stalled.fetch_add(static_cast<uint64_t>(dt.count()), std::memory_order_relaxed);
+        }
+
+        if(c.Error != 0)
+            throw ReadError(error::formatError(c.Error));
+
+        if(c.Filled == 0) //end of file
+            break;
+
+        size_t n = std::min(amount - total, c.Filled - c.Consumed);
+        Buffer.insert(Buffer.end(), c.Data.data() + c.Consumed, c.Data.data() + c.Consumed + n);
+        c.Consumed += n;
+        total += n;
+
+        if(c.Consumed == c.Filled) //chunk drained: reuse it for read-ahead
+        {
+            schedule(c);
+            Current = (Current + 1) % Chunks.size();
+        }
+    }
+
+    return total;
+}
+
+std::pair<const void*, size_t> PrefetchSource::extendBuffer(size_t amount)
+{
+    auto nread = read(amount);
+    return { Buffer.data() + Begin, nread };
+}
+
+std::pair<const void*, size_t> PrefetchSource::advanceBuffer(size_t amount)
+{
+    assert(amount <= Buffer.size() - Begin);
+
+    Begin += amount;
+    Position += amount;
+
+    auto nread = read(amount);
+    return { Buffer.data() + Begin, nread };
+}
+
+std::pair<const void*, size_t> PrefetchSource::bufferProperties() const
+{
+    return { Buffer.data() + Begin, Buffer.size() - Begin };
+}
+
+std::unique_ptr<ISourceSeek> PrefetchSource::sourceTell() const
+{
+    auto s = std::make_unique<S>();
+    s->Position = Position;
+    return s;
+}
+
+void PrefetchSource::sourceSeek(const ISourceSeek &s)
+{
+    const auto &k = static_cast<const S&>(s);
+
+    Position = k.Position;
+    Buffer.clear();
+    Begin = 0;
+    restart(Position);
+}
+
+uint64_t PrefetchSource::sourceOffset() const
+{
+    return Position;
+}
+
+void PrefetchSource::sourceSeekOffset(uint64_t offset)
+{
+    S k;
+    k.Position = offset;
+    sourceSeek(k);
+}
+
+}
\ No newline at end of file
@@ -0,0 +1,105 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <atomic>
+#include <cstdint>
+#include <mlib/platform.hpp>
+
+#include "../codec.hpp"
+
+namespace mlib::codec::video::prefetchsource
+{
+
+//
+// exceptions
+//
+
+struct PrefetchError : public CodecError
+{
+    PrefetchError(const std::string &e) : CodecError(".prefetchsource" + e) {}
+};
+
+struct OpenError : public PrefetchError
+{
+    OpenError(const std::string &path, const std::string &msg) : PrefetchError(".open (" + path + ") (" + msg + ")") {}
+};
+
+struct ReadError : public PrefetchError
+{
+    ReadError(const std::string &msg) : PrefetchError(".read (" + msg + ")") {}
+};
+
+//
+// prefetching file sourcebuffer
+//
+// Keeps depth chunks of chunksize bytes of read-ahead in flight and serves the buffer from completed chunks.
+// Reads are issued through io_uring if available (Linux, liburing), otherwise by a reader thread.
+// - prefetchMisses returns how often the caller had to wait for a chunk, may be called from any thread.
+// - stallNanoseconds returns the total time spent waiting.
+//
+
+class PrefetchSource : public ICodecSourcebuffer
+{
+public:
+    PrefetchSource(const std::string &path, size_t chunksize = 1024 * 1024, size_t depth = 4);
+    ~PrefetchSource();
+
+    std::pair<const void*, size_t> extendBuffer(size_t length) override;
+    std::pair<const void*, size_t> advanceBuffer(size_t amount) override;
+    std::pair<const void*, size_t> bufferProperties() const override;
+
+    std::unique_ptr<ISourceSeek> sourceTell() const override;
+    void sourceSeek(const ISourceSeek&) override;
+
+    uint64_t sourceOffset() const override;
+    void sourceSeekOffset(uint64_t offset) override;
+
+    uint64_t prefetchMisses() const { return Misses.load(std::memory_order_relaxed); }
+    uint64_t stallNanoseconds() const { return Stalled.load(std::memory_order_relaxed); }
+
+    PrefetchSource(PrefetchSource&&) = delete;
+    PrefetchSource(const PrefetchSource&) = delete;
+    PrefetchSource &operator=(PrefetchSource&&) = delete;
+    PrefetchSource &operator=(const PrefetchSource&) = delete;
+
+private:
+    struct Chunk
+    {
+        std::vector<char> Data;
+        uint64_t Offset;
+        size_t Expected, Filled, Consumed;
+        int Error;
+        bool Done;
+    };
+
+    struct Reader;
+    struct UringReader;
+    struct ThreadReader;
+
+    void schedule(Chunk &c);
+    void restart(uint64_t offset);
+    size_t read(size_t amount);
+
+#ifdef MLIB_PLATFORM_WIN32
+    void *File;
+#else
+    int File;
+#endif
+    uint64_t Filesize;
+    size_t Chunksize;
+
+    std::vector<Chunk> Chunks;
+    size_t Current;
+    uint64_t NextOffset;
+    std::unique_ptr<Reader> Backend;
+
+    std::vector<char> Buffer;
+    size_t Begin;
+    uint64_t Position;
+
+    std::atomic<uint64_t> Misses, Stalled;
+};
+
+}
@@ -0,0 +1,241 @@
+#include "ringsource.hpp"
+
+#include <mlib/error/nativeerror.hpp>
+
+#ifdef MLIB_PLATFORM_WIN32
+#include <Windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <cerrno>
+#if defined MLIB_PLATFORM_LINUX || defined MLIB_PLATFORM_ANDROID
+#include <sys/syscall.h>
+#include <linux/memfd.h>
+#else
+#include <atomic>
+#endif
+#endif
+
+#include <istream>
+#include <cstring>
+#include <cassert>
+#include <algorithm>
+
+namespace mlib::codec::video::ringsource
+{
+
+struct S : public ISourceSeek
+{
+    std::streampos Position;
+};
+
+//
+// mirrored mapping
+//
+
+#ifdef MLIB_PLATFORM_WIN32
+
+RingSource::Mapping RingSource::map(size_t capacity)
+{
+    SYSTEM_INFO inf;
+    GetSystemInfo(&inf);
+    size_t gran = inf.dwAllocationGranularity;
+    capacity = (capacity + gran - 1) / gran * gran;
+
+    Mapping m;
+    m.Capacity = capacity;
+    m.Handle = CreateFileMappingW(INVALID_HANDLE_VALUE, nullptr, PAGE_READWRITE,
+        static_cast<DWORD>(static_cast<unsigned long long>(capacity) >> 32), static_cast<DWORD>(capacity), nullptr);
+    if(!m.Handle)
+        throw MapError(error::formatError(GetLastError()));
+
+    for(int attempt = 0; attempt < 16; ++attempt) //another thread might take the address range in between
+    {
+        auto addr = static_cast<char*>(VirtualAlloc(nullptr, capacity * 2, MEM_RESERVE, PAGE_NOACCESS));
+        if(!addr)
+            break;
+        VirtualFree(addr, 0, MEM_RELEASE);
+
+        auto lo = static_cast<char*>(MapViewOfFileEx(m.Handle, FILE_MAP_ALL_ACCESS, 0, 0, capacity, addr));
+        if(!lo)
+            continue;
+
+        auto hi = static_cast<char*>(MapViewOfFileEx(m.Handle, FILE_MAP_ALL_ACCESS, 0, 0, capacity, addr + capacity));
+        if(!hi)
+        {
+            UnmapViewOfFile(lo);
+            continue;
+        }
+
+        m.Base = lo;
+        return m;
+    }
+
+    auto e = GetLastError();
+    CloseHandle(m.Handle);
+    throw MapError(error::formatError(e));
+}
+
+void RingSource::unmap(Mapping &m)
+{
+    UnmapViewOfFile(m.Base);
+    UnmapViewOfFile(m.Base + m.Capacity);
+    CloseHandle(m.Handle);
+}
+
+#else
+
+static int createShared()
+{
+#if defined MLIB_PLATFORM_LINUX || defined MLIB_PLATFORM_ANDROID
+    return static_cast<int>(syscall(SYS_memfd_create, "mlib.ringsource", MFD_CLOEXEC));
+#else
+    static std::atomic<unsigned int> counter{ 0 };
+    std::string name = "/mlib.ringsource." + std::to_string(getpid()) + "." + std::to_string(counter++);
+
+    int fd = shm_open(name.c_str(), O_RDWR | O_CREAT | O_EXCL, 0600);
+    if(fd >= 0)
+        shm_unlink(name.c_str());
+    return fd;
+#endif
+}
+
+RingSource::Mapping RingSource::map(size_t capacity)
+{
+    size_t page = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+    capacity = (capacity + page - 1) / page * page;
+
+    int fd = createShared();
+    if(fd < 0)
+        throw MapError(error::formatError(errno));
+
+    auto fail = [&](void *base)
+    {
+        auto e = errno;
+        if(base != MAP_FAILED)
+            munmap(base, capacity * 2);
+        close(fd);
+        throw MapError(error::formatError(e));
+    };
+
+    if(ftruncate(fd, static_cast<off_t>(capacity)) != 0)
+        fail(MAP_FAILED);
+
+    void *base = mmap(nullptr, capacity * 2, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0); //reserve address range
+    if(base == MAP_FAILED)
+        fail(MAP_FAILED);
+
+    auto lo = static_cast<char*>(base);
+    if(mmap(lo, capacity, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, fd, 0) == MAP_FAILED ||
+       mmap(lo + capacity, capacity, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, fd, 0) == MAP_FAILED)
+        fail(base);
+
+    close(fd); //mappings keep the memory alive
+
+    Mapping m;
+    m.Base = lo;
+    m.Capacity = capacity;
+    return m;
+}
+
+void RingSource::unmap(Mapping &m)
+{
+    munmap(m.Base, m.Capacity * 2);
+}
+
+#endif
+
+//
+// source
+//
+
+RingSource::RingSource(std::istream &i, size_t capacity) : Source(&i), Ring(map(capacity)), Head(0), Length(0), Position(0)
+{
+}
+
+RingSource::~RingSource()
+{
+    unmap(Ring);
+}
+
+void RingSource::grow(size_t capacity)
+{
+    auto newring = map(capacity);
+    std::memcpy(newring.Base, Ring.Base + Head, Length);
+    unmap(Ring);
+
+    Ring = newring;
+    Head = 0;
+}
+
+size_t RingSource::read(size_t amount)
+{
+    Source->read(Ring.Base + Head + Length, static_cast<std::streamsize>(amount)); //contiguous thanks to the mirror
+    auto nread = static_cast<size_t>(Source->gcount());
+    Length += nread;
+    return nread;
+}
+
+std::pair<const void*, size_t> RingSource::extendBuffer(size_t amount)
+{
+    if(Length + amount > Ring.Capacity)
+        grow(std::max(Length + amount, Ring.Capacity * 2));
+
+    auto nread = read(amount);
+    return { Ring.Base + Head, nread };
+}
+
+std::pair<const void*, size_t> RingSource::advanceBuffer(size_t amount)
+{
+    assert(amount <= Length);
+
+    Head += amount;
+    if(Head >= Ring.Capacity)
+        Head -= Ring.Capacity;
+    Length -= amount;
+    Position += amount;
+
+    auto nread = read(amount);
+    return { Ring.Base + Head, nread };
+}
+
+std::pair<const void*, size_t> RingSource::bufferProperties() const
+{
+    return { Ring.Base + Head, Length };
+}
+
+std::unique_ptr<ISourceSeek> RingSource::sourceTell() const
+{
+    auto s = std::make_unique<S>();
+    s->Position = Position;
+    return s;
+}
+
+void RingSource::sourceSeek(const ISourceSeek &s)
+{
+    const auto &k = static_cast<const S&>(s);
+    Source->clear();
+    Source->seekg(k.Position, std::ios::beg);
+    if(Source->bad())
+        throw SeekError(static_cast<std::streamoff>(k.Position));
+
+    Position = k.Position;
+    Head = 0;
+    Length = 0;
+}
+
+uint64_t RingSource::sourceOffset() const
+{
+    return static_cast<uint64_t>(static_cast<std::streamoff>(Position));
+}
+
+void RingSource::sourceSeekOffset(uint64_t offset)
+{
+    S k;
+    k.Position = static_cast<std::streamoff>(offset);
+    sourceSeek(k);
+}
+
+}
\ No newline at end of file
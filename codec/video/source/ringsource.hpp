@@ -0,0 +1,82 @@
+#pragma once
+
+#include <iosfwd>
+#include <string>
+#include <mlib/platform.hpp>
+
+#include "../codec.hpp"
+
+namespace mlib::codec::video::ringsource
+{
+
+//
+// exceptions
+//
+
+struct RingError : public CodecError
+{
+    RingError(const std::string &e) : CodecError(".ringsource" + e) {}
+};
+
+struct MapError : public RingError
+{
+    MapError(const std::string &msg) : RingError(".map (" + msg + ")") {}
+};
+
+struct SeekError : public RingError
+{
+    SeekError(std::streamoff seekpos) : RingError(".seek (" + std::to_string(seekpos) + ")") {}
+};
+
+//
+// std::istream sourcebuffer backed by a mirrored ring buffer
+//
+// The same memory pages are mapped twice back to back, so the buffer is always contiguous
+// while advancing it is pointer arithmetic only.
+// The capacity is rounded up to the allocation granularity and grows if the buffer is extended beyond it.
+//
+
+class RingSource : public ICodecSourcebuffer
+{
+public:
+    RingSource(std::istream &i, size_t capacity = 1024 * 1024);
+    ~RingSource();
+
+    std::pair<const void*, size_t> extendBuffer(size_t length) override;
+    std::pair<const void*, size_t> advanceBuffer(size_t amount) override;
+    std::pair<const void*, size_t> bufferProperties() const override;
+
+    std::unique_ptr<ISourceSeek> sourceTell() const override;
+    void sourceSeek(const ISourceSeek&) override;
+
+    uint64_t sourceOffset() const override;
+    void sourceSeekOffset(uint64_t offset) override;
+
+    RingSource(RingSource&&) = delete;
+    RingSource(const RingSource&) = delete;
+    RingSource &operator=(RingSource&&) = delete;
+    RingSource &operator=(const RingSource&) = delete;
+
+private:
+    struct Mapping
+    {
+        char *Base;
+        size_t Capacity;
+#ifdef MLIB_PLATFORM_WIN32
+        void *Handle;
+#endif
+    };
+
+    static Mapping map(size_t capacity);
+    static void unmap(Mapping &m);
+
+    void grow(size_t capacity);
+    size_t read(size_t amount);
+
+    std::istream *Source;
+    Mapping Ring;
+    size_t Head, Length;
+    std::streampos Position;
+};
+
+}
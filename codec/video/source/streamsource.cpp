@@ -1,5 +1,7 @@
 #include "streamsource.hpp"
 
+#include <istream>
+#include <cstring>
 #include <cassert>
 
 namespace mlib::codec::video::streamsource
@@ -32,7 +34,7 @@ std::pair<const void*, size_t> StreamSource::advanceBuffer(size_t amount)
     assert(amount <= Buffer.size());
 
     auto remaining = Buffer.size() - amount;
-    std::memcpy(Buffer.data(), Buffer.data() + amount, remaining);
+    std::memmove(Buffer.data(), Buffer.data() + amount, remaining);
     Source->read(Buffer.data() + remaining, amount);
 
     size_t nread = static_cast<size_t>(Source->gcount());
@@ -66,4 +68,15 @@ void StreamSource::sourceSeek(const ISourceSeek &s)
     Buffer.clear();
 }
 
+uint64_t StreamSource::sourceOffset() const
+{
+    return static_cast<uint64_t>(static_cast<std::streamoff>(Position));
+}
+void StreamSource::sourceSeekOffset(uint64_t offset)
+{
+    S k;
+    k.Position = static_cast<std::streamoff>(offset);
+    sourceSeek(k);
+}
+
 }
\ No newline at end of file
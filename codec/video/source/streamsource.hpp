@@ -1,3 +1,5 @@
+#pragma once
+
 #include <iosfwd>
 #include <vector>
 
@@ -36,6 +38,9 @@ public:
     std::unique_ptr<ISourceSeek> sourceTell() const override;
     void sourceSeek(const ISourceSeek&) override;
 
+    uint64_t sourceOffset() const override;
+    void sourceSeekOffset(uint64_t offset) override;
+
 private:
     std::istream *Source;
     std::vector<char> Buffer;
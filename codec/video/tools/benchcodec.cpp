@@ -0,0 +1,762 @@
+//
+// Benchmarks the video decoders on synthetic streams and writes the results as JSON.
+// Usage: benchcodec [--frames=n] [--runs=n] [--out=file] [--check]
+//
+// H264 streams are encoded with openh264, PIQ version 2 files are written with every payload, stbi as PNG.
+// Each decoder runs on every source type, FrameseqDecodec on frames decoded into memory and
+// Pxconv both behind the H264 decoder and on large frames with 1 to 16 threads and one per hardware thread.
+// Per benchmark, the JSON result holds frames/s, input bytes/s and the 50th and 99th percentile
+// of fetchFrame latency over all runs. Input bytes are the stream's size, or the frames'
+// pixel bytes for decoders reading frames from memory.
+//
+// The start code scanners are measured in bytes/s on 1080p and 4K H264 streams, where frames
+// counts the start codes found and latencies are per pass over the stream.
+//
+// Before benchmarking, checks that conversions keep the byte order of the formats and that the
+// SIMD start code scanners agree with the scalar one, failing if not. --check runs the checks only.
+//
+
+#include "../h264/decodeh264.hpp"
+#include "../h264/startcode.hpp"
+#include "../piq/decodepiq.hpp"
+#include "../piq/encodepiq.hpp"
+#include "../piq/payloadpiq.hpp"
+#include "../source/memorysource.hpp"
+#include "../source/streamsource.hpp"
+#include "../source/ringsource.hpp"
+#include "../source/mmapsource.hpp"
+#include "../source/prefetchsource.hpp"
+#include "../frameseq.hpp"
+#include "../frameutil.hpp"
+#include "../framepool.hpp"
+#include "../pxconv.hpp"
+
+#include <wels/codec_api.h>
+
+#define STB_IMAGE_WRITE_STATIC
+#define STB_IMAGE_WRITE_IMPLEMENTATION
+#if defined(__GNUC__)
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wunused-function"
+#endif
+#include <stb_image_write.h>
+#if defined(__GNUC__)
+#pragma GCC diagnostic pop
+#endif
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <filesystem>
+#include <functional>
+#include <algorithm>
+#include <chrono>
+#include <string>
+#include <vector>
+#include <memory>
+#include <stdexcept>
+#include <cstring>
+#include <cstdio>
+#include <cstdlib>
+
+using namespace mlib::codec::video;
+
+//
+// synthetic frames
+//
+
+//moving gradient over blocks of noise, so encoders see both motion and texture
+static uint8_t pattern(unsigned int x, unsigned int y, unsigned int frame)
+{
+    uint32_t b = ((x + frame * 2) >> 3) * 0x9e3779b1u ^ (y >> 3) * 0x85ebca6bu;
+    b ^= b >> 15;
+    return static_cast<uint8_t>((x + y + frame * 4) / 2 + (b & 0x3f));
+}
+
+static void patternI420(std::vector<uint8_t> &planes, unsigned int width, unsigned int height, unsigned int frame)
+{
+    size_t luma = (size_t)width * height;
+    planes.resize(luma + luma / 2);
+
+    uint8_t *p = planes.data();
+    for(unsigned int y = 0; y < height; ++y)
+        for(unsigned int x = 0; x < width; ++x)
+            *p++ = pattern(x, y, frame);
+
+    for(unsigned int y = 0; y < height / 2; ++y)
+        for(unsigned int x = 0; x < width / 2; ++x)
+        {
+            p[(size_t)y * (width / 2) + x] = static_cast<uint8_t>(128 + (x + frame) % 32);
+            p[luma / 4 + (size_t)y * (width / 2) + x] = static_cast<uint8_t>(128 - (y + frame) % 32);
+        }
+}
+
+static void patternRGBA(std::vector<uint8_t> &pixels, unsigned int width, unsigned int height, unsigned int frame)
+{
+    pixels.resize((size_t)width * height * 4);
+
+    uint8_t *p = pixels.data();
+    for(unsigned int y = 0; y < height; ++y)
+        for(unsigned int x = 0; x < width; ++x, p += 4)
+        {
+            p[0] = pattern(x, y, frame);
+            p[1] = static_cast<uint8_t>(x * 255 / width);
+            p[2] = static_cast<uint8_t>(y * 255 / height);
+            p[3] = 255;
+        }
+}
+
+//
+// synthetic streams
+//
+
+static std::string encodeH264(unsigned int width, unsigned int height, unsigned int frames)
+{
+    ISVCEncoder *encoder = nullptr;
+    if(WelsCreateSVCEncoder(&encoder) != 0 || !encoder)
+        throw std::runtime_error("cannot create h264 encoder");
+    std::unique_ptr<ISVCEncoder, void(*)(ISVCEncoder*)> guard(encoder, WelsDestroySVCEncoder);
+
+    SEncParamExt param;
+    encoder->GetDefaultParams(&param);
+    param.iUsageType = CAMERA_VIDEO_NON_REAL_TIME;
+    param.iPicWidth = (int)width;
+    param.iPicHeight = (int)height;
+    param.iTargetBitrate = (int)(width * height * 3);
+    param.iRCMode = RC_BITRATE_MODE;
+    param.fMaxFrameRate = 30;
+    param.uiIntraPeriod = 30;
+    param.iSpatialLayerNum = 1;
+    param.iTemporalLayerNum = 1;
+    param.iMultipleThreadIdc = 0;
+    param.bEnableFrameSkip = false;
+    param.sSpatialLayers[0].iVideoWidth = (int)width;
+    param.sSpatialLayers[0].iVideoHeight = (int)height;
+    param.sSpatialLayers[0].fFrameRate = 30;
+    param.sSpatialLayers[0].iSpatialBitrate = param.iTargetBitrate;
+
+    if(encoder->InitializeExt(&param) != cmResultSuccess)
+        throw std::runtime_error("cannot initialize h264 encoder (" + std::to_string(width) + "x" + std::to_string(height) + ")");
+
+    std::vector<uint8_t> planes;
+    SSourcePicture pic;
+    std::memset(&pic, 0, sizeof(pic));
+    pic.iColorFormat = videoFormatI420;
+    pic.iPicWidth = (int)width;
+    pic.iPicHeight = (int)height;
+    pic.iStride[0] = (int)width;
+    pic.iStride[1] = pic.iStride[2] = (int)width / 2;
+
+    std::string stream;
+    SFrameBSInfo info;
+    for(unsigned int f = 0; f < frames; ++f)
+    {
+        patternI420(planes, width, height, f);
+        pic.pData[0] = planes.data();
+        pic.pData[1] = pic.pData[0] + (size_t)width * height;
+        pic.pData[2] = pic.pData[1] + (size_t)width * height / 4;
+        pic.uiTimeStamp = f * 1000ll / 30;
+
+        std::memset(&info, 0, sizeof(info));
+        if(encoder->EncodeFrame(&pic, &info) != cmResultSuccess)
+            throw std::runtime_error("h264 encoding failed");
+        if(info.eFrameType == videoFrameTypeSkip)
+            continue;
+
+        for(int l = 0; l < info.iLayerNum; ++l)
+        {
+            const SLayerBSInfo &layer = info.sLayerInfo[l];
+            size_t bytes = 0;
+            for(int n = 0; n < layer.iNalCount; ++n)
+                bytes += layer.pNalLengthInByte[n];
+            stream.append(reinterpret_cast<const char*>(layer.pBsBuf), bytes);
+        }
+    }
+
+    encoder->Uninitialize();
+    return stream;
+}
+
+//RGBA PNG written by stb_image_write, the format image sequences are usually stored in
+static std::vector<char> encodePng(const uint8_t *rgba, unsigned int width, unsigned int height)
+{
+    std::vector<char> v;
+    auto append = [](void *context, void *data, int size) {
+        auto *out = static_cast<std::vector<char>*>(context);
+        out->insert(out->end(), static_cast<const char*>(data), static_cast<const char*>(data) + size);
+    };
+    if(!stbi_write_png_to_func(append, &v, (int)width, (int)height, 4, rgba, (int)width * 4))
+        throw std::runtime_error("PNG encoding failed");
+    return v;
+}
+
+static std::string encodePiq(unsigned int width, unsigned int height, unsigned int frames, uint32_t tag)
+{
+    std::stringstream out;
+    piq::Writer writer(out, frames);
+
+    std::vector<uint8_t> pixels;
+    for(unsigned int f = 0; f < frames; ++f)
+    {
+        patternRGBA(pixels, width, height, f);
+        auto data = tag == piq::Codectag::Stbi ? encodePng(pixels.data(), width, height) : piq::encodePayload(pixels.data(), width, height, tag);
+        writer.addFrame(data.data(), data.size(), tag);
+    }
+
+    writer.finish();
+    return out.str();
+}
+
+//
+// conversion check
+//
+// A PIQ frame of flat 2x2 blocks, so that chroma subsampling loses nothing, is converted to every
+// format with a known layout, comparing the bytes with those expected, and back to RGBA32I.
+// Round trips alone would miss byte order errors made the same way in both directions.
+//
+
+static std::vector<uint8_t> convertTo(const Videoframe &src, Pixelformat to)
+{
+    Frameseq seq;
+    seq.append(src);
+    FrameseqDecodec dec(seq);
+    Pxconv conv(dec, to);
+
+    Videoframe f;
+    if(!conv.fetchFrame(f))
+        throw std::runtime_error("conversion check: no frame");
+
+    std::vector<uint8_t> v(frameBytes(f.Format, f.Width, f.Height));
+    copyFrame(f, v.data());
+    return v;
+}
+
+static void checkBytes(const char *what, const std::vector<uint8_t> &got, const std::vector<uint8_t> &expected, int tolerance)
+{
+    if(got.size() != expected.size())
+        throw std::runtime_error(std::string("conversion check: ") + what + ": wrong size");
+
+    for(size_t i = 0; i < got.size(); ++i)
+    {
+        if(std::abs(got[i] - expected[i]) > tolerance)
+            throw std::runtime_error(std::string("conversion check: ") + what + ": byte " + std::to_string(i) + " is "
+                + std::to_string(got[i]) + ", expected " + std::to_string(expected[i]));
+    }
+}
+
+static void checkConversions()
+{
+    const unsigned int width = 16, height = 16;
+    const uint8_t colors[][3] = { { 255, 0, 0 }, { 0, 255, 0 }, { 0, 0, 255 }, { 200, 120, 40 }, { 30, 90, 220 }, { 128, 128, 128 } };
+
+    std::vector<uint8_t> rgba((size_t)width * height * 4);
+    for(unsigned int y = 0; y < height; ++y)
+        for(unsigned int x = 0; x < width; ++x)
+        {
+            const uint8_t *c = colors[(x / 2 + y / 2 * 3) % 6];
+            uint8_t *p = &rgba[((size_t)y * width + x) * 4];
+            p[0] = c[0];
+            p[1] = c[1];
+            p[2] = c[2];
+            p[3] = 255;
+        }
+
+    //the frame as returned by the PIQ decoder
+    std::string file;
+    {
+        std::stringstream out;
+        piq::Writer writer(out, 1);
+        auto data = piq::encodePayload(rgba.data(), width, height, piq::Codectag::Raw);
+        writer.addFrame(data.data(), data.size(), piq::Codectag::Raw);
+        writer.finish();
+        file = out.str();
+    }
+
+    memorysource::MemorySource src(file.data(), file.size());
+    piq::Decoder decoder(src);
+    Videoframe frame;
+    if(!decoder.fetchFrame(frame) || frame.Format != Pixelformat::RGBA32I)
+        throw std::runtime_error("conversion check: no PIQ frame");
+
+    std::vector<uint8_t> piqbytes(frameBytes(frame.Format, frame.Width, frame.Height));
+    copyFrame(frame, piqbytes.data());
+    checkBytes("PIQ RGBA32I", piqbytes, rgba, 0);
+
+    size_t pixels = (size_t)width * height;
+    std::vector<uint8_t> bgra(pixels * 4), rgb(pixels * 3), rgb565(pixels * 2), luma(pixels);
+    for(size_t i = 0; i < pixels; ++i)
+    {
+        const uint8_t *p = &rgba[i * 4];
+        bgra[i * 4] = p[2];
+        bgra[i * 4 + 1] = p[1];
+        bgra[i * 4 + 2] = p[0];
+        bgra[i * 4 + 3] = p[3];
+        std::memcpy(&rgb[i * 3], p, 3);
+
+        unsigned int word = (p[0] >> 3) << 11 | (p[1] >> 2) << 5 | p[2] >> 3;
+        rgb565[i * 2] = static_cast<uint8_t>(word);
+        rgb565[i * 2 + 1] = static_cast<uint8_t>(word >> 8);
+
+        luma[i] = static_cast<uint8_t>((66 * p[0] + 129 * p[1] + 25 * p[2] + 128) / 256 + 16); //BT.601 studio range
+    }
+
+    checkBytes("BGRA32I", convertTo(frame, Pixelformat::BGRA32I), bgra, 0);
+    checkBytes("RGB24I", convertTo(frame, Pixelformat::RGB24I), rgb, 0);
+    checkBytes("RGB16I", convertTo(frame, Pixelformat::RGB16I), rgb565, 0);
+
+    auto yuv = convertTo(frame, Pixelformat::YUV12P);
+    checkBytes("YUV12P luma", std::vector<uint8_t>(yuv.begin(), yuv.begin() + pixels), luma, 2);
+
+    //back to RGBA32I, YUV24P is left out as libyuv interpolates chroma when upsampling it
+    const std::pair<Pixelformat, int> formats[] = {
+        { Pixelformat::BGRA32I, 0 }, { Pixelformat::RGB24I, 0 }, { Pixelformat::RGB16I, 7 },
+        { Pixelformat::YUV12P, 6 }, { Pixelformat::YUV12S, 6 }
+    };
+    for(auto [fmt, tolerance] : formats)
+    {
+        auto bytes = convertTo(frame, fmt);
+        auto there = layoutFrame(fmt, width, height, bytes.data());
+        checkBytes(("round trip " + std::to_string((int)fmt)).c_str(), convertTo(there, Pixelformat::RGBA32I), rgba, tolerance);
+    }
+}
+
+//
+// start code check
+//
+// The SIMD scanners must find the same start code as the scalar one, also when it straddles
+// their 16 or 32 byte blocks, so every offset of a start code is tried from every begin offset,
+// on backgrounds without zero bytes, of zero bytes only and of near misses like 00 00 02.
+//
+
+static const std::pair<const char*, h264::Startcodescan> Startcodescans[] = {
+    { "scalar", h264::Startcodescan::Scalar }, { "sse2", h264::Startcodescan::SSE2 }, { "avx2", h264::Startcodescan::AVX2 }
+};
+
+static void checkStartcodes()
+{
+    const size_t length = 100;
+    std::vector<unsigned char> buf(length);
+    size_t scalar = 0, simd = 0;
+
+    for(int background = 0; background < 3; ++background)
+        for(size_t code = 0; code + 3 <= length; ++code)
+        {
+            for(size_t i = 0; i < length; ++i)
+                buf[i] = background == 0 ? 0x55 : background == 1 ? 0 : static_cast<unsigned char>((i * 7 + code) % 5 % 3);
+            buf[code] = 0;
+            buf[code + 1] = 0;
+            buf[code + 2] = 1;
+
+            for(size_t begin = 0; begin <= 40; ++begin)
+                for(size_t end = begin; end <= length; ++end)
+                {
+                    h264::findStartcode(h264::Startcodescan::Scalar, buf.data(), begin, end, scalar);
+                    for(auto &[name, scan] : Startcodescans)
+                        if(h264::findStartcode(scan, buf.data(), begin, end, simd) && simd != scalar)
+                            throw std::runtime_error(std::string("start code check: ") + name + " found " + std::to_string(simd) +
+                                ", scalar " + std::to_string(scalar) + " (code at " + std::to_string(code) + ", range " +
+                                std::to_string(begin) + "-" + std::to_string(end) + ")");
+                }
+        }
+}
+
+//
+// measurement
+//
+
+struct Result
+{
+    std::string Codec, Source, Stream, Params;
+    size_t Frames = 0;
+    uint64_t Bytes = 0;
+    double Seconds = 0;
+    std::vector<double> Latencies; //microseconds
+};
+
+using Clock = std::chrono::steady_clock;
+
+//pixelbytes counts the frames' pixels as input instead of the stream's size
+static void measure(Result &r, IVideoDecodec &decoder, uint64_t streambytes, bool pixelbytes = false)
+{
+    Videoframe f;
+    auto begin = Clock::now(), last = begin;
+
+    for(;;)
+    {
+        bool more = decoder.fetchFrame(f);
+        auto now = Clock::now();
+        if(!more)
+        {
+            last = now;
+            break;
+        }
+
+        r.Latencies.push_back(std::chrono::duration<double, std::micro>(now - last).count());
+        ++r.Frames;
+        if(pixelbytes)
+            r.Bytes += frameBytes(f.Format, f.Width, f.Height);
+        last = now;
+    }
+
+    r.Seconds += std::chrono::duration<double>(last - begin).count();
+    if(!pixelbytes)
+        r.Bytes += streambytes;
+}
+
+static double percentile(std::vector<double> v, double p)
+{
+    if(v.empty())
+        return 0;
+
+    std::sort(v.begin(), v.end());
+    size_t rank = static_cast<size_t>(p * (v.size() - 1) + 0.5);
+    return v[rank];
+}
+
+//
+// sources
+//
+
+static const char *const Sourcenames[] = { "memory", "stream", "ring", "mmap", "prefetch" };
+
+struct Sourceholder
+{
+    std::istringstream In;
+    std::unique_ptr<ICodecSourcebuffer> Source;
+};
+
+static std::unique_ptr<Sourceholder> openSource(const std::string &kind, const std::string &data, const std::string &path)
+{
+    auto h = std::make_unique<Sourceholder>();
+
+    if(kind == "memory")
+        h->Source = std::make_unique<memorysource::MemorySource>(data.data(), data.size());
+    else if(kind == "stream")
+    {
+        h->In.str(data);
+        h->Source = std::make_unique<streamsource::StreamSource>(h->In);
+    }
+    else if(kind == "ring")
+    {
+        h->In.str(data);
+        h->Source = std::make_unique<ringsource::RingSource>(h->In);
+    }
+    else if(kind == "mmap")
+        h->Source = std::make_unique<mmapsource::MmapSource>(path);
+    else
+        h->Source = std::make_unique<prefetchsource::PrefetchSource>(path);
+
+    return h;
+}
+
+//
+// benchmarks
+//
+
+struct Options
+{
+    unsigned int Frames = 60;
+    unsigned int Runs = 3;
+    std::string Out;
+};
+
+using Decoderfactory = std::function<std::unique_ptr<IVideoDecodec>(ICodecSourcebuffer&)>;
+
+static std::string tempPath(const std::string &name)
+{
+    return (std::filesystem::temp_directory_path() / ("benchcodec-" + name)).string();
+}
+
+//runs a decoder on all sources, the stream being written to a temporary file for the file sources
+static void benchSources(std::vector<Result> &results, const Options &opts, const std::string &codec, const std::string &streamname,
+    const std::string &data, const std::string &params, const Decoderfactory &factory)
+{
+    std::string path = tempPath(streamname);
+    {
+        std::ofstream out(path, std::ios::binary);
+        if(!out.write(data.data(), data.size()))
+            throw std::runtime_error("cannot write " + path);
+    }
+
+    for(const char *kind : Sourcenames)
+    {
+        Result r{ codec, kind, streamname, params };
+        for(unsigned int run = 0; run < opts.Runs; ++run)
+        {
+            auto source = openSource(kind, data, path);
+            auto decoder = factory(*source->Source);
+            measure(r, *decoder, data.size());
+        }
+
+        std::cerr << codec << " " << streamname << " " << params << " " << kind << ": " << r.Frames / r.Seconds << " frames/s\n";
+        results.push_back(std::move(r));
+    }
+
+    std::filesystem::remove(path);
+}
+
+//H264 decoder followed by a conversion, as used for display
+struct Convchain : public IVideoDecodec
+{
+    h264::Decoder Decoder;
+    Pxconv Conv;
+
+    Convchain(ICodecSourcebuffer &src, Pixelformat fmt) : Decoder(src), Conv(Decoder, fmt) {}
+
+    void codecLogging(CodecLoglevel l, CodecLogger g) override { Conv.codecLogging(l, g); }
+    void codecParameter(const std::string &p, const std::string &v) override { Conv.codecParameter(p, v); }
+    bool fetchFrame(Videoframe &f) override { return Conv.fetchFrame(f); }
+    std::unique_ptr<ISourceSeek> tellFrame() const override { return Conv.tellFrame(); }
+    void seekFrame(const ISourceSeek &s) override { Conv.seekFrame(s); }
+};
+
+static void benchH264(std::vector<Result> &results, const Options &opts)
+{
+    const unsigned int sizes[][2] = { { 640, 360 }, { 1280, 720 }, { 1920, 1080 } };
+
+    for(auto &s : sizes)
+    {
+        std::string name = "h264-" + std::to_string(s[1]) + "p";
+        std::string stream = encodeH264(s[0], s[1], opts.Frames);
+
+        benchSources(results, opts, "h264", name, stream, "", [](ICodecSourcebuffer &src) {
+            return std::make_unique<h264::Decoder>(src);
+        });
+
+        //conversion to RGBA behind the decoder, as used for display
+        benchSources(results, opts, "pxconv(h264)", name, stream, "RGBA32I", [](ICodecSourcebuffer &src) {
+            return std::make_unique<Convchain>(src, Pixelformat::RGBA32I);
+        });
+    }
+}
+
+static void benchPiq(std::vector<Result> &results, const Options &opts)
+{
+    const std::pair<const char*, uint32_t> payloads[] = {
+        { "stbi", piq::Codectag::Stbi }, { "raw", piq::Codectag::Raw }, { "qoi", piq::Codectag::Qoi }, { "lz4", piq::Codectag::Lz4 }
+    };
+
+    for(auto &[payload, tag] : payloads)
+    {
+        std::string name = std::string("piq-360p-") + payload;
+        std::string file = encodePiq(640, 360, opts.Frames, tag);
+        std::cerr << name << ": " << file.size() << " bytes\n";
+
+        benchSources(results, opts, "piq", name, file, "", [](ICodecSourcebuffer &src) {
+            return std::make_unique<piq::Decoder>(src);
+        });
+
+        benchSources(results, opts, "piq", name, file, "lookahead=4", [](ICodecSourcebuffer &src) {
+            return std::make_unique<piq::Decoder>(src, std::vector<std::pair<std::string, std::string>>{ { "lookahead", "4" } });
+        });
+    }
+}
+
+static void benchFrameseq(std::vector<Result> &results, const Options &opts)
+{
+    std::string stream = encodeH264(1280, 720, opts.Frames);
+    memorysource::MemorySource src(stream.data(), stream.size());
+    h264::Decoder decoder(src);
+    decoder.codecFramepool(std::make_shared<Framepool>());
+
+    Frameseq seq;
+    Videoframe f;
+    while(decoder.fetchFrame(f))
+        seq.append(f);
+
+    Result r{ "frameseq", "frameseq", "h264-720p", "" };
+    for(unsigned int run = 0; run < opts.Runs; ++run)
+    {
+        FrameseqDecodec dec(seq);
+        measure(r, dec, 0, true);
+    }
+
+    std::cerr << "frameseq: " << r.Frames / r.Seconds << " frames/s\n";
+    results.push_back(std::move(r));
+}
+
+//start code scanning speed on encoded streams, each scanner over the whole stream per pass
+static void benchStartcodes(std::vector<Result> &results, const Options &opts)
+{
+    const unsigned int sizes[][2] = { { 1920, 1080 }, { 3840, 2160 } };
+    const unsigned int passes = 20;
+
+    for(auto &s : sizes)
+    {
+        std::string name = "h264-" + std::to_string(s[1]) + "p";
+        std::string stream = encodeH264(s[0], s[1], opts.Frames);
+        auto *buf = reinterpret_cast<const unsigned char*>(stream.data());
+
+        for(auto &[scanname, scan] : Startcodescans)
+        {
+            size_t pos = 0;
+            if(!h264::findStartcode(scan, buf, 0, 0, pos))
+                continue;
+
+            Result r{ "startcode", "memory", name, scanname };
+            for(unsigned int run = 0; run < opts.Runs * passes; ++run)
+            {
+                auto begin = Clock::now();
+                for(pos = 0; h264::findStartcode(scan, buf, pos, stream.size(), pos) && pos < stream.size(); pos += 3)
+                    ++r.Frames;
+                auto end = Clock::now();
+
+                r.Latencies.push_back(std::chrono::duration<double, std::micro>(end - begin).count());
+                r.Seconds += std::chrono::duration<double>(end - begin).count();
+                r.Bytes += stream.size();
+            }
+
+            std::cerr << "startcode " << name << " " << scanname << ": " << r.Bytes / r.Seconds / 1e9 << " GB/s\n";
+            results.push_back(std::move(r));
+        }
+    }
+}
+
+//Pxconv threading on frames of a sequence sharing one synthetic I420 image
+static void benchPxconv(std::vector<Result> &results, const Options &opts)
+{
+    const std::pair<const char*, std::pair<unsigned int, unsigned int>> sizes[] = {
+        { "1080p", { 1920, 1080 } }, { "4k", { 3840, 2160 } }, { "8k", { 7680, 4320 } }
+    };
+    //every thread count up to 16, then 0 for one per hardware thread
+    std::vector<std::string> threads;
+    for(unsigned int t = 1; t <= 16; ++t)
+        threads.push_back(std::to_string(t));
+    threads.push_back("0");
+
+    for(auto &[name, size] : sizes)
+    {
+        auto [width, height] = size;
+        auto planes = std::make_shared<std::vector<uint8_t>>();
+        patternI420(*planes, width, height, 0);
+
+        Videoframe frame = layoutFrame(Pixelformat::YUV12P, width, height, planes->data());
+        frame.Owner = planes;
+
+        Frameseq seq;
+        for(unsigned int i = 0; i < opts.Frames; ++i)
+            seq.append(frame);
+
+        for(const std::string &t : threads)
+        {
+            Result r{ "pxconv", "frameseq", std::string("i420-") + name, "RGBA32I,convthreads=" + t };
+            for(unsigned int run = 0; run < opts.Runs; ++run)
+            {
+                FrameseqDecodec dec(seq);
+                Pxconv conv(dec, Pixelformat::RGBA32I);
+                conv.codecParameter("convthreads", t);
+                measure(r, conv, 0, true);
+            }
+
+            //input bytes of the I420 frames
+            r.Bytes = r.Frames * frameBytes(Pixelformat::YUV12P, width, height);
+            std::cerr << "pxconv " << name << " threads " << t << ": " << r.Frames / r.Seconds << " frames/s\n";
+            results.push_back(std::move(r));
+        }
+    }
+}
+
+//
+// output
+//
+
+static std::string quote(const std::string &s)
+{
+    std::string q = "\"";
+    for(char c : s)
+    {
+        if(c == '"' || c == '\\')
+            q += '\\';
+        q += c;
+    }
+    return q + "\"";
+}
+
+static void writeJson(std::ostream &out, const Options &opts, const std::vector<Result> &results)
+{
+    char num[64];
+    auto fmt = [&num](double d, int digits = 3) { std::snprintf(num, sizeof(num), "%.*f", digits, d); return std::string(num); };
+
+    out << "{\n  \"frames\": " << opts.Frames << ",\n  \"runs\": " << opts.Runs << ",\n  \"results\": [\n";
+    for(size_t i = 0; i < results.size(); ++i)
+    {
+        const Result &r = results[i];
+        double seconds = r.Seconds > 0 ? r.Seconds : 1;
+
+        out << "    { \"codec\": " << quote(r.Codec)
+            << ", \"source\": " << quote(r.Source)
+            << ", \"stream\": " << quote(r.Stream)
+            << ", \"params\": " << quote(r.Params)
+            << ", \"frames\": " << r.Frames
+            << ", \"bytes\": " << r.Bytes
+            << ", \"seconds\": " << fmt(r.Seconds, 6)
+            << ", \"fps\": " << fmt(r.Frames / seconds)
+            << ", \"bytes_per_second\": " << fmt(r.Bytes / seconds)
+            << ", \"p50_us\": " << fmt(percentile(r.Latencies, 0.5))
+            << ", \"p99_us\": " << fmt(percentile(r.Latencies, 0.99))
+            << " }" << (i + 1 < results.size() ? "," : "") << "\n";
+    }
+    out << "  ]\n}\n";
+}
+
+int main(int argc, char **argv)
+{
+    Options opts;
+    bool checkonly = false;
+    for(int i = 1; i < argc; ++i)
+    {
+        std::string a = argv[i];
+        if(a == "--check")
+        {
+            checkonly = true;
+            continue;
+        }
+        if(a.rfind("--frames=", 0) == 0 && std::sscanf(a.c_str() + 9, "%u", &opts.Frames) == 1 && opts.Frames > 0)
+            continue;
+        if(a.rfind("--runs=", 0) == 0 && std::sscanf(a.c_str() + 7, "%u", &opts.Runs) == 1 && opts.Runs > 0)
+            continue;
+        if(a.rfind("--out=", 0) == 0)
+        {
+            opts.Out = a.substr(6);
+            continue;
+        }
+
+        std::cout << "Description: Benchmarks the video decoders on synthetic streams.\n";
+        std::cout << "Usage: [--frames=n] [--runs=n] [--out=file] [--check]\n";
+        std::cout << "Results are written as JSON to the output file or standard output.\n";
+        return 1;
+    }
+
+    try
+    {
+        checkConversions();
+        checkStartcodes();
+        std::cerr << "conversion and start code checks passed\n";
+        if(checkonly)
+            return 0;
+
+        std::vector<Result> results;
+        benchH264(results, opts);
+        benchPiq(results, opts);
+        benchFrameseq(results, opts);
+        benchPxconv(results, opts);
+        benchStartcodes(results, opts);
+
+        if(opts.Out.empty())
+            writeJson(std::cout, opts, results);
+        else
+        {
+            std::ofstream out(opts.Out);
+            writeJson(out, opts, results);
+            if(!out)
+                throw std::runtime_error("cannot write " + opts.Out);
+        }
+    }
+    catch(std::exception &e)
+    {
+        std::cerr << e.what() << "\n";
+        return 1;
+    }
+
+    return 0;
+}
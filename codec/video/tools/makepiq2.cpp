@@ -0,0 +1,107 @@
+//
+// Creates a PIQ version 2 container from multiple image files.
+// Usage: makepiq2 [--payload=stbi|raw|qoi|lz4] <output file> <input files...>
+// Input files are sorted by their name, identical images are stored once.
+// Payloads other than stbi store the images decoded by stb_image, see payloadpiq.hpp.
+//
+
+#include "../piq/encodepiq.hpp"
+#include "../piq/payloadpiq.hpp"
+#include "../piq/imagepiq.hpp"
+
+#include <iostream>
+#include <fstream>
+#include <iterator>
+#include <algorithm>
+#include <string>
+#include <vector>
+#include <stdexcept>
+
+using namespace mlib::codec::video;
+
+static std::vector<char> payload(const std::vector<char> &image, uint32_t tag)
+{
+    unsigned int w, h;
+    auto px = piq::loadImage(image.data(), image.size(), w, h);
+    if(!px)
+        throw std::runtime_error("cannot decode image");
+
+    return piq::encodePayload(px.get(), w, h, tag);
+}
+
+int main(int argc, char **argv)
+{
+    uint32_t tag = piq::Codectag::Stbi;
+    int first = 1;
+    if(argc > 1 && std::string(argv[1]).rfind("--payload=", 0) == 0)
+    {
+        std::string p = argv[1] + 10;
+        if(p == "raw")
+            tag = piq::Codectag::Raw;
+        else if(p == "qoi")
+            tag = piq::Codectag::Qoi;
+        else if(p == "lz4")
+            tag = piq::Codectag::Lz4;
+        else if(p != "stbi")
+        {
+            std::cerr << "unknown payload " << p << "\n";
+            return 1;
+        }
+        ++first;
+    }
+
+    if(argc - first < 2)
+    {
+        std::cout << "Description: Creates a PIQ (picture sequence)-container from multiple input files.\n";
+        std::cout << "Usage: [--payload=stbi|raw|qoi|lz4] <output file> <input files...>\n";
+        std::cout << "Input files are sorted by their name, identical images are stored once.\n";
+        return 1;
+    }
+
+    const char *outname = argv[first];
+    std::vector<std::string> files(argv + first + 1, argv + argc);
+    std::sort(files.begin(), files.end());
+
+    std::fstream out(outname, std::ios::in | std::ios::out | std::ios::trunc | std::ios::binary); //read back to compare duplicates
+    if(!out)
+    {
+        std::cerr << "cannot open " << outname << "\n";
+        return 1;
+    }
+
+    try
+    {
+        piq::Writer writer(out, static_cast<uint32_t>(files.size()));
+
+        for(size_t idx = 0; idx < files.size(); ++idx)
+        {
+            std::ifstream in(files[idx], std::ios::binary);
+            if(!in)
+            {
+                std::cerr << "cannot open " << files[idx] << "\n";
+                return 1;
+            }
+
+            std::vector<char> all((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+            std::cout << idx << ": " << files[idx] << " (length: " << all.size() << ")\n";
+
+            if(tag == piq::Codectag::Stbi)
+                writer.addFrame(all.data(), all.size());
+            else
+            {
+                auto data = payload(all, tag);
+                writer.addFrame(data.data(), data.size(), tag);
+            }
+        }
+
+        writer.finish();
+        std::cout << files.size() << " files (" << writer.uniqueFrames() << " unique) -> " << outname << "\n";
+    }
+    catch(std::exception &e)
+    {
+        std::cerr << e.what() << "\n";
+        return 1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,62 @@
+#include "workerpool.hpp"
+
+#include <utility>
+#include <algorithm>
+
+namespace mlib::codec::video
+{
+
+Workerpool::Workerpool(size_t threads) : Stopping(false)
+{
+    if(threads == 0)
+        threads = std::max(1u, std::thread::hardware_concurrency());
+
+    for(size_t i = 0; i < threads; ++i)
+        Threads.emplace_back(&Workerpool::work, this);
+}
+
+Workerpool::~Workerpool()
+{
+    {
+        std::lock_guard<std::mutex> l(Lock);
+        Stopping = true;
+    }
+    Wakeup.notify_all();
+
+    for(auto &t : Threads)
+        t.join();
+}
+
+std::future<void> Workerpool::post(std::function<void()> job)
+{
+    std::packaged_task<void()> task(std::move(job));
+    auto fut = task.get_future();
+    {
+        std::lock_guard<std::mutex> l(Lock);
+        Jobs.push_back(std::move(task));
+    }
+    Wakeup.notify_one();
+
+    return fut;
+}
+
+void Workerpool::work()
+{
+    for(;;)
+    {
+        std::packaged_task<void()> task;
+        {
+            std::unique_lock<std::mutex> l(Lock);
+            Wakeup.wait(l, [&]() { return Stopping || !Jobs.empty(); });
+            if(Jobs.empty())
+                return;
+
+            task = std::move(Jobs.front());
+            Jobs.pop_front();
+        }
+
+        task();
+    }
+}
+
+}
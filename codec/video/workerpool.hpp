@@ -0,0 +1,48 @@
+#pragma once
+
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <future>
+#include <functional>
+
+namespace mlib::codec::video
+{
+
+//
+// worker pool
+//
+// Runs posted jobs on a fixed number of threads.
+// - post enqueues a job and returns a future which receives its completion or exception.
+// - A thread count of 0 selects the number of hardware threads.
+// Pending jobs are completed before the pool is destroyed.
+//
+
+class Workerpool
+{
+public:
+    Workerpool(size_t threads = 0);
+    ~Workerpool();
+
+    std::future<void> post(std::function<void()> job);
+    size_t size() const { return Threads.size(); }
+
+    Workerpool(Workerpool&&) = delete;
+    Workerpool(const Workerpool&) = delete;
+    Workerpool &operator=(Workerpool&&) = delete;
+    Workerpool &operator=(const Workerpool&) = delete;
+
+private:
+    void work();
+
+    std::vector<std::thread> Threads;
+    std::deque<std::packaged_task<void()>> Jobs;
+    bool Stopping;
+
+    std::mutex Lock;
+    std::condition_variable Wakeup;
+};
+
+}